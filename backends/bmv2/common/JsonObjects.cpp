@@ -152,6 +152,7 @@ JsonObjects::add_header_type(const cstring& name, Util::JsonArray*& fields, unsi
     if (max_length > 0)
         header_type->emplace("max_length", max_length);
     header_types->append(header_type);
+    map_header_type.emplace(name, header_type);
     return id;
 }
 
@@ -193,6 +194,7 @@ JsonObjects::add_header_type(const cstring& name) {
     auto temp = new Util::JsonArray();
     header_type->emplace("fields", temp);
     header_types->append(header_type);
+    map_header_type.emplace(name, header_type);
     return id;
 }
 
@@ -201,8 +203,10 @@ JsonObjects::add_header_type(const cstring& name) {
 void
 JsonObjects::add_header_field(const cstring& name, Util::JsonArray*& field) {
     CHECK_NULL(field);
-    Util::JsonObject* headerType = find_object_by_name(header_types, name);
-    Util::JsonArray* fields = headerType->get("fields")->to<Util::JsonArray>();
+    // Looked up in a map: the scalars header type may get thousands of fields
+    auto it = map_header_type.find(name);
+    BUG_CHECK(it != map_header_type.end(), "header '%1%' not found", name);
+    Util::JsonArray* fields = it->second->get("fields")->to<Util::JsonArray>();
     BUG_CHECK(fields != nullptr, "header '%1%' not found", name);
     fields->append(field);
 }
@@ -299,9 +303,10 @@ void
 JsonObjects::add_enum(const cstring& enum_name, const cstring& entry_name,
                       const unsigned entry_value) {
     // look up enum in json by name
-    Util::JsonObject* enum_json = find_object_by_name(enums, enum_name);
+    Util::JsonObject* enum_json = ::get(map_enum, enum_name);
     if (enum_json == nullptr) {  // first entry in a new enum
         enum_json = new Util::JsonObject();
+        map_enum.emplace(enum_name, enum_json);
         enum_json->emplace("name", enum_name);
         auto entries = insert_array_field(enum_json, "entries");
         auto entry = new Util::JsonArray();
@@ -65,6 +65,8 @@ class JsonObjects {
 
     std::map<unsigned, Util::JsonObject*> map_parser;
     std::map<unsigned, Util::JsonObject*> map_parser_state;
+    std::map<cstring, Util::JsonObject*> map_header_type;
+    std::map<cstring, Util::JsonObject*> map_enum;
 
     Util::JsonObject* toplevel;
     Util::JsonObject* meta;
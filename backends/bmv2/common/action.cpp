@@ -19,6 +19,42 @@ limitations under the License.
 
 namespace BMV2 {
 
+namespace {
+
+/// Finds the variables of a control which are used by a single action.
+class FindActionLocals : public Inspector {
+    P4::ReferenceMap* refMap;
+    /// The action using each variable; nullptr if the variable is also
+    /// used elsewhere.
+    std::map<const IR::Declaration_Variable*, const IR::P4Action*> user;
+
+ public:
+    std::map<const IR::P4Action*, std::set<cstring>> locals;
+
+    explicit FindActionLocals(P4::ReferenceMap* refMap) : refMap(refMap)
+    { setName("FindActionLocals"); }
+    void postorder(const IR::PathExpression* expression) override {
+        auto decl = refMap->getDeclaration(expression->path, true);
+        auto var = decl->to<IR::Declaration_Variable>();
+        if (var == nullptr)
+            return;
+        auto action = findContext<IR::P4Action>();
+        auto it = user.find(var);
+        if (it == user.end())
+            user.emplace(var, action);
+        else if (it->second != action)
+            it->second = nullptr;
+    }
+    void end_apply() override {
+        for (auto it : user) {
+            if (it.second != nullptr)
+                locals[it.second].emplace(it.first->name.name);
+        }
+    }
+};
+
+}  // namespace
+
 cstring ActionConverter::jsonAssignment(const IR::Type* type, bool inParser) {
     if (!inParser && type->is<IR::Type_Varbits>())
         return "assign_VL";
@@ -151,12 +187,30 @@ ActionConverter::convertActionParams(const IR::ParameterList *parameters,
     }
 }
 
+const std::set<cstring>& ActionConverter::getLocals(const IR::P4Action* action) {
+    static const std::set<cstring> none;
+    auto control = ::get(ctxt->structure->actions, action);
+    if (control == nullptr)
+        return none;
+    auto it = actionLocals.find(control);
+    if (it == actionLocals.end()) {
+        FindActionLocals find(ctxt->refMap);
+        control->apply(find);
+        it = actionLocals.emplace(control, std::move(find.locals)).first;
+    }
+    auto locals = it->second.find(action);
+    return locals == it->second.end() ? none : locals->second;
+}
+
 void ActionConverter::postorder(const IR::P4Action* action) {
     cstring name = action->controlPlaneName();
     auto params = new Util::JsonArray();
     convertActionParams(action->parameters, params);
     auto body = new Util::JsonArray();
     convertActionBody(&action->body->components, body);
+    if (optimizer == nullptr)
+        optimizer = new PrimitiveOptimizer(ctxt->json, ctxt->conv->getScalarsName());
+    optimizer->optimize(body, getLocals(action));
     auto id = ctxt->json->add_action(name, params, body);
     LOG3("add action with id " << id << " name " << name << " " << action);
     ctxt->structure->ids.emplace(action, id);
@@ -19,17 +19,23 @@ limitations under the License.
 
 #include "ir/ir.h"
 #include "helpers.h"
+#include "primitiveOptimizer.h"
 
 namespace BMV2 {
 
 class ActionConverter : public Inspector {
     ConversionContext* ctxt;
+    PrimitiveOptimizer* optimizer = nullptr;
+    /// For each control, the scalar variables used by a single action.
+    std::map<const IR::P4Control*,
+             std::map<const IR::P4Action*, std::set<cstring>>> actionLocals;
 
     void convertActionBody(const IR::Vector<IR::StatOrDecl>* body,
                            Util::JsonArray* result);
     void convertActionParams(const IR::ParameterList *parameters,
                              Util::JsonArray* params);
     cstring jsonAssignment(const IR::Type* type, bool inParser);
+    const std::set<cstring>& getLocals(const IR::P4Action* action);
     void postorder(const IR::P4Action* action) override;
 
  public:
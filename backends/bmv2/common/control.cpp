@@ -352,6 +352,11 @@ ControlConverter::convertTable(const CFG::TableNode* node,
                 int l = slice->getL();
                 mask = Util::maskFromSlice(h, l);
             }
+            // BMv2 applies a key mask on every lookup; a mask covering
+            // the whole field does not change the key.
+            if (mask != 0 && (mask & Util::mask(expr->type->width_bits())) ==
+                Util::mask(expr->type->width_bits()))
+                mask = 0;
 
             auto keyelement = new Util::JsonObject();
             keyelement->emplace("match_type", match_type);
@@ -696,6 +701,7 @@ bool ControlConverter::preorder(const IR::P4Control* cont) {
     bool success = cfg->checkImplementable();
     if (!success)
         return false;
+    cfg->optimize();
 
     if (cfg->entryPoint->successors.size() == 0) {
         result->emplace("init_table", Util::JsonValue::null);
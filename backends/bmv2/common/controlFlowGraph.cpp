@@ -181,6 +181,305 @@ bool CFG::checkImplementable() const {
     return true;
 }
 
+namespace {
+
+/// The destination of the Boolean edge 'value' of an IfNode.
+CFG::Node* branch(const CFG::Node* node, bool value) {
+    for (auto e : node->successors.edges) {
+        if (e->isBool() && e->getBool() == value)
+            return e->endpoint;
+    }
+    return nullptr;
+}
+
+/// Matches conditions of the form 'expr == constant' and 'expr != constant'.
+bool isConstantComparison(const IR::Expression* cond, const IR::Expression*& expr,
+                          const IR::Constant*& constant, bool& equal) {
+    if (!cond->is<IR::Equ>() && !cond->is<IR::Neq>())
+        return false;
+    auto binary = cond->to<IR::Operation_Binary>();
+    if (auto k = binary->right->to<IR::Constant>()) {
+        expr = binary->left;
+        constant = k;
+    } else if (auto k = binary->left->to<IR::Constant>()) {
+        expr = binary->right;
+        constant = k;
+    } else {
+        return false;
+    }
+    equal = cond->is<IR::Equ>();
+    return true;
+}
+
+/// Value of 'cond' when 'known' is known to evaluate to 'value' and
+/// no state has changed in between: 1 (true), 0 (false) or -1 when
+/// it cannot be determined.
+int impliedValue(const IR::Expression* known, bool value, const IR::Expression* cond) {
+    while (auto lnot = known->to<IR::LNot>()) {
+        known = lnot->expr;
+        value = !value;
+    }
+    bool negated = false;
+    while (auto lnot = cond->to<IR::LNot>()) {
+        cond = lnot->expr;
+        negated = !negated;
+    }
+    if (cond->equiv(*known))
+        return value != negated;
+
+    const IR::Expression* knownExpr;
+    const IR::Expression* condExpr;
+    const IR::Constant* knownConstant;
+    const IR::Constant* condConstant;
+    bool knownEqual, condEqual;
+    if (!isConstantComparison(known, knownExpr, knownConstant, knownEqual) ||
+        !isConstantComparison(cond, condExpr, condConstant, condEqual) ||
+        !condExpr->equiv(*knownExpr))
+        return -1;
+    // The same expression is compared with two constants
+    bool sameConstant = knownConstant->value == condConstant->value;
+    bool result;
+    if (knownEqual == value)
+        // expr == knownConstant
+        result = sameConstant;
+    else if (sameConstant)
+        // expr != knownConstant
+        result = false;
+    else
+        return -1;
+    return (result == condEqual) != negated;
+}
+
+/// If 'table' always executes the same action, whatever the
+/// control-plane does, return the name of this action.
+cstring constantAction(const IR::P4Table* table) {
+    auto key = table->getKey();
+    if (key != nullptr && !key->keyElements.empty())
+        return nullptr;
+    if (table->getEntries() != nullptr ||
+        table->properties->getProperty("implementation") != nullptr)
+        return nullptr;
+    auto defact = table->properties->getProperty(
+        IR::TableProperties::defaultActionPropertyName);
+    if (defact == nullptr || !defact->isConstant)
+        return nullptr;
+    auto al = table->getActionList();
+    if (al == nullptr || al->size() != 1)
+        return nullptr;
+    return al->actionList.at(0)->getName().name;
+}
+
+}  // end anonymous namespace
+
+void CFG::redirect(Node* from, Node* to) {
+    for (auto n : allNodes) {
+        for (auto e : n->successors.edges) {
+            if (e->endpoint == from)
+                e->endpoint = to;
+        }
+    }
+}
+
+void CFG::mergeTableNodes() {
+    // checkImplementable guarantees that all the nodes of a table
+    // have the same successors, so any of them can stand for the others.
+    std::map<const IR::P4Table*, TableNode*> representative;
+    std::vector<Node*> duplicates;
+    for (auto n : allNodes) {
+        auto tn = n->to<TableNode>();
+        if (tn == nullptr)
+            continue;
+        auto it = representative.find(tn->table);
+        if (it == representative.end()) {
+            representative.emplace(tn->table, tn);
+            continue;
+        }
+        LOG3("Merging " << tn << " into " << it->second);
+        redirect(tn, it->second);
+        duplicates.push_back(tn);
+    }
+    for (auto n : duplicates)
+        allNodes.erase(n);
+}
+
+// BMv2 cannot call an action without a table lookup, but when a table
+// always executes the same action its switch statement can be resolved
+// at compile time; the cases that can never run then become unreachable.
+bool CFG::resolveConstantActions() {
+    bool changed = false;
+    for (auto n : allNodes) {
+        auto tn = n->to<TableNode>();
+        if (tn == nullptr)
+            continue;
+        cstring action = constantAction(tn->table);
+        if (action.isNullOrEmpty())
+            continue;
+        Node* next = nullptr;
+        Node* actionDestination = nullptr;
+        Node* defaultLabelDestination = nullptr;
+        bool labels = false, hitMiss = false;
+        for (auto e : tn->successors.edges) {
+            if (e->isUnconditional()) {
+                next = e->endpoint;
+            } else if (e->isBool()) {
+                hitMiss = true;
+            } else {
+                labels = true;
+                if (e->label == action)
+                    actionDestination = e->endpoint;
+                else if (e->label == "default")
+                    defaultLabelDestination = e->endpoint;
+            }
+        }
+        // Whether a keyless table hits depends on the control-plane.
+        if (!labels || hitMiss)
+            continue;
+        Node* destination = actionDestination;
+        if (destination == nullptr)
+            destination = defaultLabelDestination;
+        if (destination == nullptr)
+            destination = next;
+        BUG_CHECK(destination != nullptr, "%1%: no destination", tn->invocation);
+        LOG3("Table " << tn << " always executes " << action);
+        tn->successors.edges.clear();
+        tn->successors.emplace(new Edge(destination));
+        changed = true;
+    }
+    return changed;
+}
+
+bool CFG::collapseConditionals() {
+    bool changed = false;
+    for (auto n : allNodes) {
+        auto in = n->to<IfNode>();
+        if (in == nullptr)
+            continue;
+        for (auto e : in->successors.edges) {
+            // Conditionals do not modify any state, so the condition
+            // of 'in' still holds when the next conditional is evaluated.
+            while (auto next = e->endpoint->to<IfNode>()) {
+                int value = impliedValue(in->statement->condition, e->getBool(),
+                                         next->statement->condition);
+                if (value < 0)
+                    break;
+                auto destination = branch(next, value != 0);
+                if (destination == nullptr)
+                    break;
+                LOG3("Condition of " << next << " is implied by " << in);
+                e->endpoint = destination;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+bool CFG::mergeConditionals() {
+    bool changed = false;
+    std::vector<IfNode*> kept;
+    std::vector<Node*> merged;
+    for (auto n : allNodes) {
+        auto in = n->to<IfNode>();
+        if (in == nullptr)
+            continue;
+        IfNode* same = nullptr;
+        for (auto k : kept) {
+            if (branch(k, true) == branch(in, true) &&
+                branch(k, false) == branch(in, false) &&
+                k->statement->condition->equiv(*in->statement->condition)) {
+                same = k;
+                break;
+            }
+        }
+        if (same == nullptr) {
+            kept.push_back(in);
+            continue;
+        }
+        LOG3("Merging " << in << " into " << same);
+        redirect(in, same);
+        merged.push_back(in);
+        changed = true;
+    }
+    for (auto n : merged)
+        allNodes.erase(n);
+    return changed;
+}
+
+// A conditional whose branches lead to the same node is hoisted out of
+// the paths which follow it: evaluating it is useless.
+bool CFG::removeInvariantConditionals() {
+    std::vector<Node*> removed;
+    for (auto n : allNodes) {
+        auto in = n->to<IfNode>();
+        if (in == nullptr)
+            continue;
+        Node* destination = nullptr;
+        auto ifTrue = branch(in, true);
+        auto ifFalse = branch(in, false);
+        if (auto bl = in->statement->condition->to<IR::BoolLiteral>())
+            destination = bl->value ? ifTrue : ifFalse;
+        else if (ifTrue == ifFalse)
+            destination = ifTrue;
+        if (destination == nullptr)
+            continue;
+        LOG3("Removing invariant conditional " << in);
+        redirect(in, destination);
+        removed.push_back(in);
+    }
+    for (auto n : removed)
+        allNodes.erase(n);
+    return !removed.empty();
+}
+
+void CFG::removeUnreachable() {
+    // Tables are kept even when unreachable, since the control-plane
+    // can still refer to them.
+    std::set<Node*> reachable;
+    std::vector<Node*> work;
+    for (auto n : allNodes) {
+        if (n == entryPoint || n->is<TableNode>())
+            work.push_back(n);
+    }
+    while (!work.empty()) {
+        auto n = work.back();
+        work.pop_back();
+        if (!reachable.emplace(n).second)
+            continue;
+        for (auto e : n->successors.edges)
+            work.push_back(e->endpoint);
+    }
+    std::vector<Node*> unreachable;
+    for (auto n : allNodes) {
+        if (n->is<IfNode>() && reachable.find(n) == reachable.end())
+            unreachable.push_back(n);
+    }
+    for (auto n : unreachable)
+        allNodes.erase(n);
+}
+
+void CFG::computePredecessors() {
+    for (auto n : allNodes)
+        n->predecessors.edges.clear();
+    for (auto n : allNodes) {
+        for (auto e : n->successors.edges)
+            e->endpoint->predecessors.emplace(e->clone(n));
+    }
+}
+
+void CFG::optimize() {
+    mergeTableNodes();
+    resolveConstantActions();
+    bool changed;
+    do {
+        changed = collapseConditionals();
+        changed |= mergeConditionals();
+        changed |= removeInvariantConditionals();
+    } while (changed);
+    removeUnreachable();
+    computePredecessors();
+    LOG2("Optimized " << this);
+}
+
 namespace {
 class CFGBuilder : public Inspector {
     CFG*                    cfg;
@@ -180,6 +180,10 @@ class CFG final : public IHasDbPrint {
     /// BMv2 is very restricted in the kinds of graphs it supports.
     /// Thie method checks whether a CFG is implementable.
     bool checkImplementable() const;
+    /// Simplify an implementable CFG to reduce the number of nodes
+    /// that BMv2 evaluates for each packet.  Only successors are
+    /// rewritten; predecessors are recomputed at the end.
+    void optimize();
 
  private:
     bool dfs(Node* node, std::set<Node*> &visited,
@@ -190,6 +194,24 @@ class CFG final : public IHasDbPrint {
     /// This requires their successor edgesets to be "compatible" with
     /// each other.  This is a constraint specific to BMv2.
     bool checkMergeable(std::set<TableNode*> nodes) const;
+
+    /// Make all edges pointing to 'from' point to 'to' instead.
+    void redirect(Node* from, Node* to);
+    /// Replace all the TableNodes of a table with a single node.
+    void mergeTableNodes();
+    /// Resolve the successors of tables which always execute the
+    /// same action.
+    bool resolveConstantActions();
+    /// Skip conditionals whose outcome is implied by the conditional
+    /// that immediately precedes them.
+    bool collapseConditionals();
+    /// Merge conditionals with the same condition and successors.
+    bool mergeConditionals();
+    /// Remove conditionals which do not influence control flow.
+    bool removeInvariantConditionals();
+    /// Remove the IfNodes that no entry point or table can reach.
+    void removeUnreachable();
+    void computePredecessors();
 };
 
 }  // namespace BMV2
@@ -727,7 +727,7 @@ ExpressionConverter::convert(const IR::Expression* e, bool doFixup, bool wrap, b
         result = obj;
     }
 
-    std::set<cstring> to_wrap({"expression", "stack_field"});
+    static const std::set<cstring> to_wrap({"expression", "stack_field"});
     // This is weird, but that's how it is: expression and stack_field must be wrapped in
     // another outer object. In a future version of the bmv2 JSON, this will not be needed
     // anymore as expressions will be treated in a more uniform way.
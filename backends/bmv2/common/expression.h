@@ -75,6 +75,8 @@ class ExpressionConverter : public Inspector {
     /// This is used for table key expressions, for example.
     bool simpleExpressionsOnly;
 
+    /// Name of the metadata instance holding the scalar variables.
+    cstring getScalarsName() const { return scalarsName; }
     /// Non-null if the expression refers to a parameter from the enclosing control
     const IR::Parameter* enclosingParamReference(const IR::Expression* expression);
 
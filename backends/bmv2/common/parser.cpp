@@ -15,10 +15,14 @@ limitations under the License.
 */
 
 #include "parser.h"
+
+#include <algorithm>
+
 #include "JsonObjects.h"
 #include "backend.h"
 #include "extern.h"
 #include "frontends/p4/fromv1.0/v1model.h"
+#include "lib/gmputil.h"
 
 namespace BMV2 {
 
@@ -377,34 +381,145 @@ Util::IJson* ParserConverter::stateName(IR::ID state) {
     }
 }
 
+void compactSelectCases(std::vector<SelectCase>& cases, const mpz_class& significant) {
+    for (auto& c : cases) {
+        if (c.is_vset)
+            continue;
+        // Cases with negative values (signed fields) are left alone.
+        if (c.value < 0)
+            return;
+    }
+    for (auto& c : cases) {
+        if (c.is_vset)
+            continue;
+        c.mask = c.mask == -1 ? significant : mpz_class(c.mask & significant);
+        c.value &= c.mask;
+    }
+
+    // Cases after a default case, or matching only keys matched
+    // by an earlier case, are never taken.
+    std::vector<SelectCase> live;
+    for (auto& c : cases) {
+        bool shadowed = false;
+        for (auto& l : live)
+            shadowed = shadowed || l.covers(c);
+        if (!shadowed)
+            live.push_back(c);
+        if (c.isDefault())
+            break;
+    }
+    cases = live;
+
+    // A case leading to the same state as the default case can be
+    // removed if no case between them matches any of its keys.
+    if (!cases.empty() && cases.back().isDefault()) {
+        for (size_t i = cases.size() - 1; i-- > 0;) {
+            if (cases.at(i).is_vset || cases.at(i).next.name != cases.back().next.name)
+                continue;
+            bool overlaps = false;
+            for (size_t k = i + 1; k + 1 < cases.size(); k++)
+                overlaps = overlaps || cases.at(k).overlaps(cases.at(i));
+            if (!overlaps)
+                cases.erase(cases.begin() + i);
+        }
+    }
+
+    // Two cases with the same mask and destination whose values differ
+    // in a single bit become one case which ignores that bit.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < cases.size() && !changed; i++) {
+            auto& first = cases.at(i);
+            if (first.is_vset || first.isDefault())
+                continue;
+            for (size_t j = i + 1; j < cases.size() && !changed; j++) {
+                auto& second = cases.at(j);
+                if (second.is_vset || second.mask != first.mask ||
+                    second.next.name != first.next.name)
+                    continue;
+                mpz_class difference = first.value ^ second.value;
+                if (bitcount(difference) != 1)
+                    continue;
+                // Moving the keys of 'second' before the cases between
+                // the two must not change which case they match.
+                bool overlaps = false;
+                for (size_t k = i + 1; k < j; k++)
+                    overlaps = overlaps || cases.at(k).overlaps(second);
+                if (overlaps)
+                    continue;
+                first.mask &= ~difference;
+                first.value &= first.mask;
+                cases.erase(cases.begin() + j);
+                changed = true;
+            }
+        }
+    }
+}
+
+namespace {
+
+bool isUnconditional(const std::vector<Util::IJson*>& transitions) {
+    if (transitions.size() != 1)
+        return false;
+    auto value = transitions.at(0)->to<Util::JsonObject>()->get("value");
+    auto jv = value == nullptr ? nullptr : value->to<Util::JsonValue>();
+    return jv != nullptr && jv->isString() && jv->getString() == "default";
+}
+
+/// The state that always follows a state with these transitions, or
+/// nullptr if it is not known or is not a parser state.
+cstring unconditionalNext(const std::vector<Util::IJson*>& transitions) {
+    if (!isUnconditional(transitions))
+        return nullptr;
+    auto next = transitions.at(0)->to<Util::JsonObject>()->get("next_state");
+    auto jv = next->to<Util::JsonValue>();
+    return jv != nullptr && jv->isString() ? jv->getString() : cstring();
+}
+
+}  // namespace
+
 std::vector<Util::IJson*>
 ParserConverter::convertSelectExpression(const IR::SelectExpression* expr) {
     std::vector<Util::IJson*> result;
     auto se = expr->to<IR::SelectExpression>();
+    std::vector<SelectCase> cases;
+    unsigned bytes = 0;
     for (auto sc : se->selectCases) {
+        SelectCase c;
+        bytes = std::max(bytes, combine(sc->keyset, se->select, c.value, c.mask,
+                                        c.is_vset, c.vset_name));
+        c.next = sc->state->path->name;
+        cases.push_back(c);
+    }
+
+    mpz_class significant = 0;
+    for (auto e : se->select->components) {
+        int width = ctxt->typeMap->getType(e, true)->width_bits();
+        significant = Util::shift_left(significant, 8 * ROUNDUP(width, 8)) + Util::mask(width);
+    }
+    compactSelectCases(cases, significant);
+
+    for (auto& c : cases) {
         auto trans = new Util::JsonObject();
-        mpz_class value, mask;
-        bool is_vset;
-        cstring vset_name;
-        unsigned bytes = combine(sc->keyset, se->select, value, mask, is_vset, vset_name);
-        if (is_vset) {
+        if (c.is_vset) {
             trans->emplace("type", "parse_vset");
-            trans->emplace("value", vset_name);
-            trans->emplace("mask", mask);
-            trans->emplace("next_state", stateName(sc->state->path->name));
+            trans->emplace("value", c.vset_name);
+            trans->emplace("mask", c.mask);
+            trans->emplace("next_state", stateName(c.next));
         } else {
-            if (mask == 0) {
+            if (c.mask == 0) {
                 trans->emplace("value", "default");
                 trans->emplace("mask", Util::JsonValue::null);
-                trans->emplace("next_state", stateName(sc->state->path->name));
+                trans->emplace("next_state", stateName(c.next));
             } else {
                 trans->emplace("type", "hexstr");
-                trans->emplace("value", stringRepr(value, bytes));
-                if (mask == -1)
+                trans->emplace("value", stringRepr(c.value, bytes));
+                if (c.mask == -1 || c.mask == significant)
                     trans->emplace("mask", Util::JsonValue::null);
                 else
-                    trans->emplace("mask", stringRepr(mask, bytes));
-                trans->emplace("next_state", stateName(sc->state->path->name));
+                    trans->emplace("mask", stringRepr(c.mask, bytes));
+                trans->emplace("next_state", stateName(c.next));
             }
         }
         result.push_back(trans);
@@ -449,40 +564,81 @@ bool ParserConverter::preorder(const IR::P4Parser* parser) {
         }
     }
 
-    // convert parse state
+    // Convert the transitions first: states which unconditionally
+    // transition to a state with no other predecessor are merged with
+    // it, which saves BMv2 a state transition per packet.
+    std::map<cstring, const IR::ParserState*> states;
+    std::map<cstring, std::vector<Util::IJson*>> transitions;
+    std::map<cstring, Util::IJson*> keys;
     for (auto state : parser->states) {
         if (state->name == IR::ParserState::reject || state->name == IR::ParserState::accept)
             continue;
-        // For the state we use the internal name, not the control-plane name
-        auto state_id = ctxt->json->add_parser_state(parser_id, state->name);
-        // convert statements
-        for (auto s : state->components) {
-            auto op = convertParserStatement(s);
-            if (op)
-                ctxt->json->add_parser_op(state_id, op);
-        }
-        // convert transitions
+        states.emplace(state->name, state);
+        auto& trans = transitions[state->name];
         if (state->selectExpression != nullptr) {
             if (state->selectExpression->is<IR::SelectExpression>()) {
                 auto expr = state->selectExpression->to<IR::SelectExpression>();
-                auto transitions = convertSelectExpression(expr);
-                for (auto transition : transitions) {
-                    ctxt->json->add_parser_transition(state_id, transition);
-                }
-                auto key = convertSelectKey(expr);
-                ctxt->json->add_parser_transition_key(state_id, key);
+                trans = convertSelectExpression(expr);
+                // The key is not needed if only the default case is left
+                if (!isUnconditional(trans))
+                    keys.emplace(state->name, convertSelectKey(expr));
             } else if (state->selectExpression->is<IR::PathExpression>()) {
                 auto expr = state->selectExpression->to<IR::PathExpression>();
-                auto transition = convertPathExpression(expr);
-                ctxt->json->add_parser_transition(state_id, transition);
+                trans.push_back(convertPathExpression(expr));
             } else {
                 BUG("%1%: unexpected selectExpression", state->selectExpression);
             }
         } else {
-            auto transition = createDefaultTransition();
-            ctxt->json->add_parser_transition(state_id, transition);
+            trans.push_back(createDefaultTransition());
+        }
+    }
+
+    std::map<cstring, unsigned> predecessors;
+    predecessors[IR::ParserState::start]++;
+    for (auto& it : transitions) {
+        for (auto t : it.second) {
+            auto next = t->to<Util::JsonObject>()->get("next_state")->to<Util::JsonValue>();
+            if (next->isString())
+                predecessors[next->getString()]++;
         }
     }
+    std::set<cstring> merged;  // states merged into their predecessor
+    for (auto& it : transitions) {
+        cstring next = unconditionalNext(it.second);
+        if (next != nullptr && next != it.first && states.count(next) &&
+            predecessors[next] == 1)
+            merged.emplace(next);
+    }
+
+    for (auto state : parser->states) {
+        if (state->name == IR::ParserState::reject || state->name == IR::ParserState::accept ||
+            merged.count(state->name))
+            continue;
+        // For the state we use the internal name, not the control-plane name
+        auto state_id = ctxt->json->add_parser_state(parser_id, state->name);
+        cstring current = state->name;
+        std::set<cstring> done;
+        while (true) {
+            done.emplace(current);
+            // convert statements
+            for (auto s : states.at(current)->components) {
+                auto op = convertParserStatement(s);
+                if (op)
+                    ctxt->json->add_parser_op(state_id, op);
+            }
+            cstring next = unconditionalNext(transitions.at(current));
+            if (next == nullptr || !merged.count(next) || done.count(next))
+                break;
+            LOG3("Merging parser state " << next << " into " << state->name);
+            current = next;
+        }
+        // convert transitions
+        for (auto transition : transitions.at(current))
+            ctxt->json->add_parser_transition(state_id, transition);
+        auto key = keys.find(current);
+        if (key != keys.end())
+            ctxt->json->add_parser_transition_key(state_id, key->second);
+    }
     return false;
 }
 
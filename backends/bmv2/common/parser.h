@@ -28,6 +28,36 @@ namespace BMV2 {
 
 class JsonObjects;
 
+/// A select case converted to a value and a mask.
+struct SelectCase {
+    bool      is_vset;
+    cstring   vset_name;
+    mpz_class value;
+    mpz_class mask;  // 0 for default, -1 for an exact match
+    IR::ID    next;
+
+    bool isDefault() const { return !is_vset && mask == 0; }
+    /// True if the two cases match a common key.
+    bool overlaps(const SelectCase& other) const {
+        if (is_vset || other.is_vset)
+            return true;
+        return ((value ^ other.value) & mask & other.mask) == 0;
+    }
+    /// True if all the keys matched by 'other' are matched by this case.
+    bool covers(const SelectCase& other) const {
+        if (is_vset || other.is_vset)
+            return false;
+        return (mask & ~other.mask) == 0 && (other.value & mask) == value;
+    }
+};
+
+/// Remove the cases which can never change the outcome of a select
+/// and coalesce cases which only differ by one bit.  'significant' has
+/// a 1 for each bit of the key that comes from a select expression.
+/// Masks are normalized to significant bits, so after compaction a
+/// mask equal to 'significant' denotes an exact match.
+void compactSelectCases(std::vector<SelectCase>& cases, const mpz_class& significant);
+
 class ParserConverter : public Inspector {
     ConversionContext*   ctxt;
     cstring              name;
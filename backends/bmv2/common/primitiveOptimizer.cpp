@@ -0,0 +1,569 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "primitiveOptimizer.h"
+#include "helpers.h"
+#include "lib/gmputil.h"
+#include "lib/log.h"
+
+namespace BMV2 {
+
+namespace {
+
+using Field = PrimitiveOptimizer::Field;
+using Accesses = PrimitiveOptimizer::Accesses;
+
+/// Shifts by more than this amount are not folded.
+const unsigned long maxShift = 4096;
+
+cstring stringValue(const Util::IJson* json) {
+    auto value = json == nullptr ? nullptr : json->to<Util::JsonValue>();
+    if (value == nullptr || !value->isString())
+        return nullptr;
+    return value->getString();
+}
+
+/// The type of a BMv2 expression, e.g., "field" or "hexstr".
+cstring typeOf(const Util::IJson* json) {
+    auto object = json == nullptr ? nullptr : json->to<Util::JsonObject>();
+    if (object == nullptr)
+        return nullptr;
+    return stringValue(object->get("type"));
+}
+
+bool getField(const Util::IJson* json, Field& field) {
+    if (typeOf(json) != "field")
+        return false;
+    auto value = json->to<Util::JsonObject>()->get("value");
+    auto array = value == nullptr ? nullptr : value->to<Util::JsonArray>();
+    if (array == nullptr || array->size() != 2)
+        return false;
+    field.first = stringValue(array->at(0));
+    field.second = stringValue(array->at(1));
+    return !field.first.isNullOrEmpty() && !field.second.isNullOrEmpty();
+}
+
+bool getHeader(const Util::IJson* json, cstring& header) {
+    if (typeOf(json) != "header")
+        return false;
+    header = stringValue(json->to<Util::JsonObject>()->get("value"));
+    return !header.isNullOrEmpty();
+}
+
+bool getConstant(const Util::IJson* json, mpz_class& value) {
+    if (typeOf(json) != "hexstr")
+        return false;
+    cstring repr = stringValue(json->to<Util::JsonObject>()->get("value"));
+    if (repr.isNullOrEmpty())
+        return false;
+    std::string digits = repr.c_str();
+    bool negative = digits[0] == '-';
+    if (negative)
+        digits = digits.substr(1);
+    if (digits.compare(0, 2, "0x") != 0 || value.set_str(digits.substr(2), 16) != 0)
+        return false;
+    if (negative)
+        value = -value;
+    return true;
+}
+
+bool getBool(const Util::IJson* json, bool& value) {
+    if (typeOf(json) != "bool")
+        return false;
+    auto v = json->to<Util::JsonObject>()->get("value");
+    auto jv = v == nullptr ? nullptr : v->to<Util::JsonValue>();
+    if (jv == nullptr || !jv->isBool())
+        return false;
+    value = jv->getBool();
+    return true;
+}
+
+Util::IJson* makeConstant(mpz_class value) {
+    auto result = new Util::JsonObject();
+    result->emplace("type", "hexstr");
+    result->emplace("value", stringRepr(value));
+    return result;
+}
+
+Util::IJson* makeBool(bool value) {
+    auto result = new Util::JsonObject();
+    result->emplace("type", "bool");
+    result->emplace("value", value);
+    return result;
+}
+
+/// Expressions which can be copied without changing the cost or the
+/// result of the expressions that contain them.
+bool isLeaf(const Util::IJson* json) {
+    cstring type = typeOf(json);
+    return type == "field" || type == "hexstr" || type == "bool" || type == "runtime_data";
+}
+
+void collectReads(const Util::IJson* json, Accesses& reads) {
+    if (json == nullptr || json->is<Util::JsonValue>())
+        // missing operand of a unary operation
+        return;
+    auto object = json->to<Util::JsonObject>();
+    if (object == nullptr) {
+        reads.all = true;
+        return;
+    }
+    if (object->get("op") != nullptr) {
+        for (auto operand : {"left", "right", "cond"})
+            collectReads(object->get(operand), reads);
+        return;
+    }
+    cstring type = typeOf(object);
+    Field field;
+    cstring header;
+    if (type == "expression")
+        collectReads(object->get("value"), reads);
+    else if (getField(object, field))
+        reads.fields.emplace(field);
+    else if (getHeader(object, header))
+        reads.headers.emplace(header);
+    else if (type != "hexstr" && type != "bool" && type != "runtime_data" && type != "string")
+        reads.all = true;
+}
+
+/// Replace 'field' with 'replacement' in a BMv2 expression, copying
+/// only the objects which change.
+Util::IJson* substitute(Util::IJson* json, const Field& field, Util::IJson* replacement) {
+    Field f;
+    if (getField(json, f))
+        return f == field ? replacement : json;
+    auto object = json == nullptr ? nullptr : json->to<Util::JsonObject>();
+    if (object == nullptr)
+        return json;
+    Util::JsonObject* result = nullptr;
+    for (auto it : *object) {
+        auto child = substitute(it.second, field, replacement);
+        if (child == it.second)
+            continue;
+        if (result == nullptr)
+            result = new Util::JsonObject(*object);
+        (*result)[it.first] = child;
+    }
+    return result != nullptr ? result : object;
+}
+
+Util::JsonObject* makePrimitive(const Util::JsonObject* original, cstring op,
+                                Util::IJson* first, Util::IJson* second) {
+    auto primitive = mkPrimitive(op);
+    auto parameters = mkParameters(primitive);
+    parameters->append(first);
+    parameters->append(second);
+    primitive->emplace_non_null("source_info", original->get("source_info"));
+    return primitive;
+}
+
+Util::IJson* foldOperation(Util::IJson* expression, Util::JsonObject* operation) {
+    cstring op = stringValue(operation->get("op"));
+    auto left = PrimitiveOptimizer::fold(operation->get("left"));
+    auto right = PrimitiveOptimizer::fold(operation->get("right"));
+    auto cond = PrimitiveOptimizer::fold(operation->get("cond"));
+
+    mpz_class a, b;
+    bool x, y;
+    bool binary = left != nullptr && left->is<Util::JsonObject>();
+    if (binary && getConstant(left, a) && getConstant(right, b)) {
+        if (op == "+")
+            return makeConstant(a + b);
+        if (op == "-")
+            return makeConstant(a - b);
+        if (op == "*")
+            return makeConstant(a * b);
+        if (op == "==")
+            return makeBool(a == b);
+        if (op == "!=")
+            return makeBool(a != b);
+        if (op == "<")
+            return makeBool(a < b);
+        if (op == ">")
+            return makeBool(a > b);
+        if (op == "<=")
+            return makeBool(a <= b);
+        if (op == ">=")
+            return makeBool(a >= b);
+        // Bitwise operations are only folded on non-negative values,
+        // whose representation does not depend on the target.
+        if (a >= 0 && b >= 0) {
+            if (op == "&")
+                return makeConstant(a & b);
+            if (op == "|")
+                return makeConstant(a | b);
+            if (op == "^")
+                return makeConstant(a ^ b);
+            if (op == "<<" && b <= maxShift)
+                return makeConstant(a << b.get_ui());
+            if (op == ">>" && b <= maxShift)
+                return makeConstant(a >> b.get_ui());
+        }
+        if (op == "two_comp_mod" && b > 0 && b <= maxShift) {
+            // The signed value represented by the 'b' lower bits of 'a'.
+            mpz_class modulus = mpz_class(1) << b.get_ui();
+            mpz_class result = a % modulus;
+            if (result < 0)
+                result += modulus;
+            if (result >= modulus / 2)
+                result -= modulus;
+            return makeConstant(result);
+        }
+    } else if (binary && getBool(left, x) && getBool(right, y)) {
+        if (op == "and")
+            return makeBool(x && y);
+        if (op == "or")
+            return makeBool(x || y);
+        if (op == "==")
+            return makeBool(x == y);
+        if (op == "!=")
+            return makeBool(x != y);
+    } else if (!binary && getConstant(right, b)) {
+        if (op == "-")
+            return makeConstant(-b);
+        if (op == "d2b")
+            return makeBool(b != 0);
+    } else if (!binary && getBool(right, y)) {
+        if (op == "not")
+            return makeBool(!y);
+        if (op == "b2d")
+            return makeConstant(y ? 1 : 0);
+    }
+    if (op == "?" && getBool(cond, x))
+        return x ? left : right;
+
+    if (left == operation->get("left") && right == operation->get("right") &&
+        cond == operation->get("cond"))
+        return expression;
+    auto folded = new Util::JsonObject(*operation);
+    if (left != nullptr)
+        (*folded)["left"] = left;
+    if (right != nullptr)
+        (*folded)["right"] = right;
+    if (cond != nullptr)
+        (*folded)["cond"] = cond;
+    auto result = new Util::JsonObject();
+    result->emplace("type", "expression");
+    result->emplace("value", folded);
+    return result;
+}
+
+}  // namespace
+
+bool PrimitiveOptimizer::Accesses::intersects(const Accesses& other) const {
+    if (all || other.all)
+        return true;
+    for (auto& f : fields) {
+        if (other.contains(f))
+            return true;
+    }
+    for (auto& f : other.fields) {
+        if (headers.count(f.first))
+            return true;
+    }
+    for (auto h : headers) {
+        if (other.headers.count(h))
+            return true;
+    }
+    return false;
+}
+
+PrimitiveOptimizer::PrimitiveOptimizer(const JsonObjects* json, cstring scalarsName) :
+        scalarsName(scalarsName) {
+    for (auto h : *json->headers) {
+        auto header = h->to<Util::JsonObject>();
+        auto metadata = header->get("metadata")->to<Util::JsonValue>();
+        if (metadata != nullptr && metadata->isBool() && metadata->getBool())
+            metadataType.emplace(stringValue(header->get("name")),
+                                 stringValue(header->get("header_type")));
+    }
+    for (auto t : *json->header_types) {
+        auto type = t->to<Util::JsonObject>();
+        auto& fields = typeFields[stringValue(type->get("name"))];
+        for (auto f : *type->get("fields")->to<Util::JsonArray>()) {
+            cstring name = stringValue(f->to<Util::JsonArray>()->at(0));
+            if (!name.startsWith("_padding"))
+                fields.emplace(name);
+        }
+    }
+}
+
+bool PrimitiveOptimizer::isAssign(const Util::JsonObject* primitive,
+                                  Field& destination, Util::IJson*& source) const {
+    if (stringValue(primitive->get("op")) != "assign")
+        return false;
+    auto parameters = primitive->get("parameters");
+    auto array = parameters == nullptr ? nullptr : parameters->to<Util::JsonArray>();
+    if (array == nullptr || array->size() != 2 || !getField(array->at(0), destination))
+        return false;
+    source = array->at(1);
+    return true;
+}
+
+bool PrimitiveOptimizer::getAccesses(const Util::JsonObject* primitive,
+                                     Accesses& reads, Accesses& writes) const {
+    Field destination;
+    Util::IJson* source;
+    if (isAssign(primitive, destination, source)) {
+        collectReads(source, reads);
+        writes.fields.emplace(destination);
+        return true;
+    }
+
+    cstring op = stringValue(primitive->get("op"));
+    auto parameters = primitive->get("parameters");
+    auto array = parameters == nullptr ? nullptr : parameters->to<Util::JsonArray>();
+    cstring dst, src;
+    if (op == "assign_header" && array != nullptr && array->size() == 2 &&
+        getHeader(array->at(0), dst) && getHeader(array->at(1), src)) {
+        reads.headers.emplace(src);
+        writes.headers.emplace(dst);
+        return true;
+    }
+    if ((op == "add_header" || op == "remove_header") && array != nullptr &&
+        array->size() == 1 && getHeader(array->at(0), dst)) {
+        // The effect depends on the current validity.
+        reads.headers.emplace(dst);
+        writes.headers.emplace(dst);
+        return true;
+    }
+    reads.all = true;
+    writes.all = true;
+    return false;
+}
+
+size_t PrimitiveOptimizer::nextAccess(size_t index, const Field& field) const {
+    for (size_t next = index + 1; next < primitives.size(); next++) {
+        Accesses reads, writes;
+        getAccesses(primitives.at(next), reads, writes);
+        if (reads.contains(field) || writes.contains(field))
+            return next;
+    }
+    return primitives.size();
+}
+
+bool PrimitiveOptimizer::readBeforeWritten(const Field& field) const {
+    for (auto primitive : primitives) {
+        Accesses reads, writes;
+        getAccesses(primitive, reads, writes);
+        if (reads.contains(field))
+            return true;
+        if (writes.fields.count(field))
+            return false;
+    }
+    return false;
+}
+
+bool PrimitiveOptimizer::isDead(size_t index, const Field& field) const {
+    size_t next = nextAccess(index, field);
+    if (next == primitives.size())
+        // Other actions, tables or conditionals may read the value; so
+        // may this action, when it is executed again by another table.
+        return isLocal(field) && !readBeforeWritten(field);
+    Field destination;
+    Util::IJson* source;
+    if (!isAssign(primitives.at(next), destination, source) || destination != field)
+        return false;
+    Accesses reads;
+    collectReads(source, reads);
+    return !reads.contains(field);
+}
+
+// tmp = E; ...; dst = f(tmp)  =>  ...; dst = f(E)
+bool PrimitiveOptimizer::forwardCopies() {
+    bool changed = false;
+    for (size_t index = 0; index < primitives.size(); index++) {
+        Field temporary;
+        Util::IJson* value;
+        if (!isAssign(primitives.at(index), temporary, value) || !isLocal(temporary))
+            continue;
+        Accesses valueReads;
+        collectReads(value, valueReads);
+        if (valueReads.all)
+            continue;
+
+        // E is evaluated at the use of the temporary instead of at its
+        // definition, so the state it reads must not change in between.
+        size_t use = nextAccess(index, temporary);
+        if (use == primitives.size())
+            continue;
+        bool blocked = false;
+        for (size_t i = index + 1; i < use && !blocked; i++) {
+            Accesses reads, writes;
+            getAccesses(primitives.at(i), reads, writes);
+            blocked = writes.intersects(valueReads);
+        }
+        Field destination;
+        Util::IJson* source;
+        if (blocked || !isAssign(primitives.at(use), destination, source))
+            continue;
+        Accesses sourceReads;
+        collectReads(source, sourceReads);
+        if (sourceReads.all || !sourceReads.contains(temporary))
+            continue;
+        if (destination != temporary && !isDead(use, temporary))
+            continue;
+
+        Util::IJson* replaced;
+        Field f;
+        if (getField(source, f) && f == temporary)
+            replaced = value;
+        else if (isLeaf(value))
+            // Larger expressions could be evaluated several times.
+            replaced = fold(substitute(source, temporary, value));
+        else
+            continue;
+        LOG3("Forwarding " << temporary.first << "." << temporary.second);
+        auto original = primitives.at(use);
+        primitives.at(use) = makePrimitive(
+            original, "assign", original->get("parameters")->to<Util::JsonArray>()->at(0),
+            replaced);
+        primitives.erase(primitives.begin() + index);
+        index--;
+        changed = true;
+    }
+    return changed;
+}
+
+bool PrimitiveOptimizer::removeDeadAssignments() {
+    bool changed = false;
+    for (size_t index = 0; index < primitives.size(); index++) {
+        Field destination, f;
+        Util::IJson* source;
+        if (!isAssign(primitives.at(index), destination, source))
+            continue;
+        bool self = getField(source, f) && f == destination;
+        if (!self && !isDead(index, destination))
+            continue;
+        LOG3("Removing dead assignment to " << destination.first << "." << destination.second);
+        primitives.erase(primitives.begin() + index);
+        index--;
+        changed = true;
+    }
+    return changed;
+}
+
+// Consecutive assignments of all the fields of a metadata instance from
+// another instance of the same type become a single assign_header.
+// This is not done for packet headers, since assign_header also copies
+// the validity.
+bool PrimitiveOptimizer::mergeHeaderCopies() {
+    bool changed = false;
+    for (size_t index = 0; index < primitives.size(); index++) {
+        Field destination, field;
+        Util::IJson* source;
+        if (!isAssign(primitives.at(index), destination, source) || !getField(source, field))
+            continue;
+        cstring dst = destination.first, src = field.first;
+        auto dstType = metadataType.find(dst);
+        auto srcType = metadataType.find(src);
+        if (dst == src || dstType == metadataType.end() || srcType == metadataType.end() ||
+            dstType->second != srcType->second)
+            continue;
+        auto& fields = typeFields.at(dstType->second);
+
+        std::set<cstring> copied;
+        size_t end = index;
+        for (; end < primitives.size(); end++) {
+            if (!isAssign(primitives.at(end), destination, source) ||
+                !getField(source, field) || destination.first != dst || field.first != src ||
+                destination.second != field.second || !fields.count(field.second) ||
+                !copied.emplace(field.second).second)
+                break;
+        }
+        if (copied.size() != fields.size())
+            continue;
+        LOG3("Copying " << src << " into " << dst);
+        auto dstHeader = new Util::JsonObject();
+        dstHeader->emplace("type", "header");
+        dstHeader->emplace("value", dst);
+        auto srcHeader = new Util::JsonObject();
+        srcHeader->emplace("type", "header");
+        srcHeader->emplace("value", src);
+        auto copy = makePrimitive(primitives.at(index), "assign_header", dstHeader, srcHeader);
+        primitives.erase(primitives.begin() + index + 1, primitives.begin() + end);
+        primitives.at(index) = copy;
+        changed = true;
+    }
+    return changed;
+}
+
+void PrimitiveOptimizer::foldConstants() {
+    for (auto& primitive : primitives) {
+        Field destination;
+        Util::IJson* source;
+        if (!isAssign(primitive, destination, source))
+            continue;
+        auto folded = fold(source);
+        if (folded != source)
+            primitive = makePrimitive(
+                primitive, "assign", primitive->get("parameters")->to<Util::JsonArray>()->at(0),
+                folded);
+    }
+}
+
+Util::IJson* PrimitiveOptimizer::fold(Util::IJson* expression) {
+    auto object = expression == nullptr ? nullptr : expression->to<Util::JsonObject>();
+    if (object == nullptr || typeOf(object) != "expression")
+        return expression;
+    auto value = object->get("value");
+    auto inner = value == nullptr ? nullptr : value->to<Util::JsonObject>();
+    if (inner == nullptr)
+        return expression;
+    if (inner->get("op") != nullptr)
+        return foldOperation(expression, inner);
+
+    // An expression wrapped as a primitive parameter; only expressions
+    // and stack fields need the wrapper.
+    auto folded = fold(inner);
+    if (folded == inner)
+        return expression;
+    cstring type = typeOf(folded);
+    if (type != "expression" && type != "stack_field")
+        return folded;
+    auto result = new Util::JsonObject();
+    result->emplace("type", "expression");
+    result->emplace("value", folded);
+    return result;
+}
+
+void PrimitiveOptimizer::optimize(Util::JsonArray* body, const std::set<cstring>& locals) {
+    this->locals = &locals;
+    primitives.clear();
+    for (auto p : *body) {
+        auto primitive = p->to<Util::JsonObject>();
+        if (primitive == nullptr)
+            return;
+        primitives.push_back(primitive);
+    }
+
+    size_t before = primitives.size();
+    foldConstants();
+    bool changed;
+    do {
+        changed = forwardCopies();
+        changed |= removeDeadAssignments();
+    } while (changed);
+    mergeHeaderCopies();
+    LOG2("Optimized " << before << " primitives into " << primitives.size());
+
+    body->clear();
+    for (auto p : primitives)
+        body->append(p);
+    this->locals = nullptr;
+}
+
+}  // namespace BMV2
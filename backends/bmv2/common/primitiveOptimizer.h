@@ -0,0 +1,105 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef BACKENDS_BMV2_COMMON_PRIMITIVEOPTIMIZER_H_
+#define BACKENDS_BMV2_COMMON_PRIMITIVEOPTIMIZER_H_
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "lib/cstring.h"
+#include "lib/json.h"
+#include "JsonObjects.h"
+
+namespace BMV2 {
+
+/// Peephole optimizer for the primitives of a BMv2 action.
+/// Statements are converted almost one-to-one into primitives, and
+/// BMv2 interprets every primitive for each packet.  This optimizer
+/// - forwards temporaries to their single use,
+/// - removes assignments whose value is never read,
+/// - merges field-by-field copies of metadata into header copies,
+/// - folds constant sub-expressions.
+/// Primitives it does not understand (externs, stack operations, ...)
+/// are barriers: nothing is moved across them.
+class PrimitiveOptimizer {
+ public:
+    /// A header instance and a field name.
+    typedef std::pair<cstring, cstring> Field;
+
+    /// Program state read or written by a primitive.
+    struct Accesses {
+        std::set<Field>   fields;
+        std::set<cstring> headers;  // all fields and the validity
+        bool              all = false;
+
+        bool contains(const Field& field) const
+        { return all || fields.count(field) || headers.count(field.first); }
+        bool intersects(const Accesses& other) const;
+    };
+
+ private:
+    cstring scalarsName;
+    /// Header type of each metadata instance.
+    std::map<cstring, cstring> metadataType;
+    /// Fields of each header type, excluding padding.
+    std::map<cstring, std::set<cstring>> typeFields;
+
+    /// Scalars which are only accessed by the action being optimized.
+    const std::set<cstring>* locals = nullptr;
+    std::vector<Util::JsonObject*> primitives;
+
+    bool isLocal(const Field& field) const
+    { return field.first == scalarsName && locals->count(field.second) != 0; }
+    /// True if the primitive is an assignment to a field; sets
+    /// 'destination' and 'source'.
+    bool isAssign(const Util::JsonObject* primitive,
+                  Field& destination, Util::IJson*& source) const;
+    /// The state read and written by a primitive.  Returns false for
+    /// barriers.
+    bool getAccesses(const Util::JsonObject* primitive,
+                     Accesses& reads, Accesses& writes) const;
+    /// Index of the first primitive after 'index' which reads or
+    /// writes 'field', or primitives.size() if there is none.
+    size_t nextAccess(size_t index, const Field& field) const;
+    /// True if the action may read the value that 'field' had when
+    /// it started, e.g., the value left by a previous execution.
+    bool readBeforeWritten(const Field& field) const;
+    /// True if the value assigned to 'field' by primitive 'index'
+    /// can never be read.
+    bool isDead(size_t index, const Field& field) const;
+
+    bool forwardCopies();
+    bool removeDeadAssignments();
+    bool mergeHeaderCopies();
+    void foldConstants();
+
+ public:
+    PrimitiveOptimizer(const JsonObjects* json, cstring scalarsName);
+    /// Optimize the primitives of an action; 'locals' are the
+    /// variables in the scalars header which no other action, table
+    /// or conditional accesses.
+    void optimize(Util::JsonArray* body, const std::set<cstring>& locals);
+    /// Constant-fold a BMv2 expression.  Returns 'expression' if
+    /// nothing can be folded; never modifies its argument.
+    static Util::IJson* fold(Util::IJson* expression);
+};
+
+}  // namespace BMV2
+
+#endif  /* BACKENDS_BMV2_COMMON_PRIMITIVEOPTIMIZER_H_ */
@@ -32,6 +32,7 @@ limitations under the License.
 #include "midend/complexComparison.h"
 #include "midend/convertEnums.h"
 #include "midend/copyStructures.h"
+#include "midend/eliminateCommonSubexpressions.h"
 #include "midend/eliminateTuples.h"
 #include "midend/eliminateNewtype.h"
 #include "midend/eliminateSerEnums.h"
@@ -106,6 +107,7 @@ SimpleSwitchMidEnd::SimpleSwitchMidEnd(CompilerOptions& options, std::ostream* o
                                 new P4::OrPolicy(
                                     new P4::IsValid(&refMap, &typeMap),
                                     new P4::IsMask())),
+            new P4::EliminateCommonSubexpressions(&refMap, &typeMap),
             new P4::MoveDeclarations(),
             new P4::ValidateTableProperties({ "implementation",
                                               "size",
@@ -287,13 +287,25 @@ void ControlBodyTranslator::processApply(const P4::ApplyMethod* method) {
     cstring valueName = "value";
     builder->appendFormat("struct %s *%s = NULL", table->valueTypeName.c_str(), valueName.c_str());
     builder->endOfStatement(true);
+    // storage for values which are not in a map
+    cstring inlinedName = "inlinedValue";
+    if (table->inlinedEntries || table->inlinedDefaultAction) {
+        builder->emitIndent();
+        builder->appendFormat("struct %s %s", table->valueTypeName.c_str(), inlinedName.c_str());
+        builder->endOfStatement(true);
+    }
 
     if (table->keyGenerator != nullptr) {
         builder->emitIndent();
-        builder->appendLine("/* perform lookup */");
-        builder->emitIndent();
-        builder->target->emitTableLookup(builder, table->dataMapName, keyname, valueName);
-        builder->endOfStatement(true);
+        if (table->inlinedEntries) {
+            builder->appendLine("/* match constant entries */");
+            table->emitInlinedLookup(builder, keyname, valueName, inlinedName);
+        } else {
+            builder->appendLine("/* perform lookup */");
+            builder->emitIndent();
+            builder->target->emitTableLookup(builder, table->dataMapName, keyname, valueName);
+            builder->endOfStatement(true);
+        }
     }
 
     builder->emitIndent();
@@ -306,10 +318,14 @@ void ControlBodyTranslator::processApply(const P4::ApplyMethod* method) {
     builder->appendFormat("%s = 0", control->hitVariable.c_str());
     builder->endOfStatement(true);
 
-    builder->emitIndent();
-    builder->target->emitTableLookup(builder, table->defaultActionMapName,
-                                     control->program->zeroKey, valueName);
-    builder->endOfStatement(true);
+    if (table->inlinedDefaultAction) {
+        table->emitInlinedDefaultAction(builder, valueName, inlinedName);
+    } else {
+        builder->emitIndent();
+        builder->target->emitTableLookup(builder, table->defaultActionMapName,
+                                         control->program->zeroKey, valueName);
+        builder->endOfStatement(true);
+    }
     builder->blockEnd(false);
     builder->append(" else ");
     builder->blockStart();
@@ -34,11 +34,13 @@ struct TableImpl_Model : public ::Model::Extern_Model {
 struct CounterArray_Model : public ::Model::Extern_Model {
     CounterArray_Model() : Extern_Model("CounterArray"),
                            increment("increment"), add("add"),
-                           max_index("max_index"), sparse("sparse")  {}
+                           max_index("max_index"), sparse("sparse"),
+                           percpu("percpu") {}
     ::Model::Elem increment;
     ::Model::Elem add;
     ::Model::Elem max_index;
     ::Model::Elem sparse;
+    ::Model::Elem percpu;  // annotation selecting per-CPU maps
 };
 
 struct Filter_Model : public ::Model::Elem {
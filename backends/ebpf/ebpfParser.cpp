@@ -30,6 +30,9 @@ class StateTranslationVisitor : public CodeGenInspector {
 
     void compileExtractField(const IR::Expression* expr, cstring name,
                              unsigned alignment, EBPFType* type);
+    void compileExtractFields(const IR::Expression* expr,
+                              const std::vector<std::pair<cstring, EBPFType*>>& fields,
+                              unsigned loadBytes);
     void compileExtract(const IR::Expression* destination);
     void compileLookahead(const IR::Expression* destination);
 
@@ -211,19 +214,30 @@ StateTranslationVisitor::compileExtractField(
 
         builder->append(")");
         builder->endOfStatement(true);
-    } else {
-        // wide values; read all bytes one by one.
-        unsigned shift;
-        if (alignment == 0)
-            shift = 0;
-        else
-            shift = 8 - alignment;
+    } else if (alignment == 0) {
+        // byte-aligned wide values (e.g., IPv6 addresses); copy all bytes at once.
+        unsigned bytes = ROUNDUP(widthToExtract, 8);
+        builder->emitIndent();
+        builder->append("memcpy(&");
+        visit(expr);
+        builder->appendFormat(".%s, (u8*)%s + BYTES(%s), %d)",
+                              field.c_str(), program->packetStartVar.c_str(),
+                              program->offsetVar.c_str(), bytes);
+        builder->endOfStatement(true);
 
-        const char* helper;
-        if (shift == 0)
-            helper = "load_byte";
-        else
-            helper = "load_half";
+        if (widthToExtract % 8 != 0) {
+            auto bt = EBPFTypeFactory::instance->create(IR::Type_Bits::get(8));
+            builder->emitIndent();
+            visit(expr);
+            builder->appendFormat(".%s[%d] &= EBPF_MASK(", field.c_str(), bytes - 1);
+            bt->emit(builder);
+            builder->appendFormat(", %d)", widthToExtract % 8);
+            builder->endOfStatement(true);
+        }
+    } else {
+        // unaligned wide values; read all bytes one by one.
+        unsigned shift = 8 - alignment;
+        const char* helper = "load_half";
         auto bt = EBPFTypeFactory::instance->create(IR::Type_Bits::get(8));
         unsigned bytes = ROUNDUP(widthToExtract, 8);
         for (unsigned i=0; i < bytes; i++) {
@@ -253,6 +267,77 @@ StateTranslationVisitor::compileExtractField(
     builder->newline();
 }
 
+// Extracts a run of fields which starts on a byte boundary and spans
+// loadBytes bytes or fewer with a single load; each field is then
+// obtained from the loaded word by shifting and masking.
+void
+StateTranslationVisitor::compileExtractFields(
+    const IR::Expression* expr, const std::vector<std::pair<cstring, EBPFType*>>& fields,
+    unsigned loadBytes) {
+    auto program = state->parser->program;
+    const char* helper = nullptr;
+    auto loadType = EBPFTypeFactory::instance->create(IR::Type_Bits::get(loadBytes * 8));
+    switch (loadBytes) {
+        case 1:
+            helper = "load_byte";
+            break;
+        case 2:
+            helper = "load_half";
+            break;
+        case 4:
+            helper = "load_word";
+            break;
+        case 8:
+            helper = "load_dword";
+            break;
+        default:
+            BUG("Unexpected load size %d", loadBytes);
+    }
+
+    builder->emitIndent();
+    builder->blockStart();
+    builder->emitIndent();
+    loadType->emit(builder);
+    builder->appendFormat(" %s = %s(%s, BYTES(%s))",
+                          program->wordVar.c_str(), helper,
+                          program->packetStartVar.c_str(),
+                          program->offsetVar.c_str());
+    builder->endOfStatement(true);
+
+    unsigned loadSize = loadBytes * 8;
+    unsigned fieldOffset = 0;
+    for (auto f : fields) {
+        auto type = f.second;
+        unsigned width = dynamic_cast<IHasWidth*>(type)->widthInBits();
+        unsigned shift = loadSize - fieldOffset - width;
+        builder->emitIndent();
+        visit(expr);
+        builder->appendFormat(".%s = (", f.first.c_str());
+        type->emit(builder);
+        builder->append(")(");
+        if (shift != 0)
+            builder->appendFormat("(%s >> %d)", program->wordVar.c_str(), shift);
+        else
+            builder->append(program->wordVar);
+        // No mask is needed if the shift or the cast drops all other bits
+        if (fieldOffset != 0 &&
+            width != dynamic_cast<IHasWidth*>(type)->implementationWidthInBits()) {
+            builder->append(" & EBPF_MASK(");
+            loadType->emit(builder);
+            builder->appendFormat(", %d)", width);
+        }
+        builder->append(")");
+        builder->endOfStatement(true);
+        fieldOffset += width;
+    }
+    builder->blockEnd(true);
+
+    builder->emitIndent();
+    builder->appendFormat("%s += %d", program->offsetVar.c_str(), fieldOffset);
+    builder->endOfStatement(true);
+    builder->newline();
+}
+
 void
 StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
     auto type = state->parser->typeMap->getType(destination);
@@ -281,7 +366,8 @@ StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
     builder->newline();
     builder->blockEnd(true);
 
-    unsigned alignment = 0;
+    std::vector<std::pair<cstring, EBPFType*>> fields;
+    std::vector<unsigned> widths;
     for (auto f : ht->fields) {
         auto ftype = state->parser->typeMap->getType(f);
         auto etype = EBPFTypeFactory::instance->create(ftype);
@@ -290,9 +376,46 @@ StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
             ::error("Only headers with fixed widths supported %1%", f);
             return;
         }
-        compileExtractField(destination, f->name, alignment, etype);
-        alignment += et->widthInBits();
-        alignment %= 8;
+        fields.emplace_back(f->name.name, etype);
+        widths.push_back(et->widthInBits());
+    }
+
+    // The bounds check above covers the whole header, so fields are
+    // coalesced into runs which start and end on byte boundaries and are
+    // read with a single 1, 2, 4 or 8 byte load.  A load may be wider than
+    // the run as long as it does not read past the end of the header.
+    unsigned headerBytes = ROUNDUP(width, 8);
+    unsigned bitOffset = 0;
+    for (size_t i = 0; i < fields.size();) {
+        size_t end = i + 1;
+        unsigned loadBytes = 0;
+        if (bitOffset % 8 == 0) {
+            unsigned runBits = 0;
+            for (size_t j = i; j < fields.size(); j++) {
+                runBits += widths.at(j);
+                if (widths.at(j) > 64 || runBits > 64)
+                    break;
+                if (runBits % 8 != 0)
+                    continue;
+                unsigned bytes = runBits / 8;
+                unsigned load = bytes <= 1 ? 1 : bytes <= 2 ? 2 : bytes <= 4 ? 4 : 8;
+                if (load == bytes || bitOffset / 8 + load <= headerBytes) {
+                    end = j + 1;
+                    loadBytes = load;
+                }
+            }
+        }
+
+        if (end > i + 1) {
+            std::vector<std::pair<cstring, EBPFType*>> run(fields.begin() + i,
+                                                           fields.begin() + end);
+            compileExtractFields(destination, run, loadBytes);
+        } else {
+            compileExtractField(destination, fields.at(i).first, bitOffset % 8,
+                                fields.at(i).second);
+        }
+        for (; i < end; i++)
+            bitOffset += widths.at(i);
     }
 
     if (ht->is<IR::Type_Header>()) {
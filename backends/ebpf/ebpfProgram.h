@@ -47,7 +47,7 @@ class EBPFProgram : public EBPFObject {
 
     cstring endLabel, offsetVar, lengthVar;
     cstring zeroKey, functionName, errorVar;
-    cstring packetStartVar, packetEndVar, byteVar;
+    cstring packetStartVar, packetEndVar, byteVar, wordVar;
     cstring errorEnum;
     cstring license = "GPL";  // TODO: this should be a compiler option probably
     cstring arrayIndexType = "u32";
@@ -66,6 +66,7 @@ class EBPFProgram : public EBPFObject {
         packetStartVar = EBPFModel::reserved("packetStart");
         packetEndVar = EBPFModel::reserved("packetEnd");
         byteVar = EBPFModel::reserved("byte");
+        wordVar = EBPFModel::reserved("word");
         endLabel = EBPFModel::reserved("end");
         errorEnum = EBPFModel::reserved("errorCodes");
     }
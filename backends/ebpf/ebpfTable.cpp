@@ -14,15 +14,32 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
+
 #include "ebpfTable.h"
 #include "ebpfType.h"
 #include "ir/ir.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/methodInstance.h"
+#include "lib/gmputil.h"
 
 namespace EBPF {
 
 namespace {
+bool isLPM(const EBPFProgram* program, const IR::KeyElement* keyElement) {
+    auto mtdecl = program->refMap->getDeclaration(keyElement->matchType->path, true);
+    auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
+    return matchType->name.name == P4::P4CoreLibrary::instance.lpmMatch.name;
+}
+
+// A C literal for a key field value
+cstring keyLiteral(const mpz_class &value, unsigned width) {
+    cstring result = cstring("0x") + value.get_str(16);
+    if (width > 32)
+        result += "ULL";
+    return result;
+}
+
 class ActionTranslationVisitor : public CodeGenInspector {
  protected:
     const EBPFProgram*  program;
@@ -75,6 +92,76 @@ EBPFTable::EBPFTable(const EBPFProgram* program, const IR::TableBlock* table,
 
     keyGenerator = table->container->getKey();
     actionList = table->container->getActionList();
+
+    inlinedEntries = canInlineEntries();
+    lpmKey = nullptr;
+    if (keyGenerator != nullptr && !inlinedEntries) {
+        for (auto c : keyGenerator->keyElements) {
+            if (isLPM(program, c))
+                lpmKey = c;
+        }
+    }
+    auto defaultAction = table->container->properties->getProperty(
+        IR::TableProperties::defaultActionPropertyName);
+    inlinedDefaultAction = defaultAction != nullptr && defaultAction->isConstant;
+}
+
+// Constant entries are compiled into code if there are few of them and
+// every key field fits in a scalar and is matched by a value or a prefix.
+bool EBPFTable::canInlineEntries() const {
+    if (keyGenerator == nullptr)
+        return false;
+    auto entries = table->container->getEntries();
+    if (entries == nullptr || entries->size() > maxInlinedEntries)
+        return false;
+    auto property = table->container->properties->getProperty(
+        IR::TableProperties::entriesPropertyName);
+    if (!property->isConstant)
+        return false;
+
+    for (auto c : keyGenerator->keyElements) {
+        auto type = program->typeMap->getType(c->expression);
+        if (type == nullptr || !type->is<IR::Type_Bits>() ||
+            !EBPFScalarType::generatesScalar(type->to<IR::Type_Bits>()->size))
+            return false;
+    }
+    for (auto e : entries->entries) {
+        const auto &keys = e->getKeys()->components;
+        if (keys.size() != keyGenerator->keyElements.size())
+            return false;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (prefixLength(keyGenerator->keyElements.at(i), keys.at(i)) < 0)
+                return false;
+        }
+        if (!e->getAction()->is<IR::MethodCallExpression>())
+            return false;
+    }
+    return true;
+}
+
+// Number of leading bits of a key field matched by an entry key:
+// the field width for a value, 0 for a don't care, the prefix length
+// for a prefix of an LPM field, and -1 for any other key.
+int EBPFTable::prefixLength(const IR::KeyElement* keyElement,
+                            const IR::Expression* entryKey) const {
+    unsigned width = program->typeMap->getType(keyElement->expression)->to<IR::Type_Bits>()->size;
+    if (entryKey->is<IR::Constant>())
+        return width;
+    if (entryKey->is<IR::DefaultExpression>())
+        return 0;
+    auto mask = entryKey->to<IR::Mask>();
+    if (mask == nullptr || !isLPM(program, keyElement) ||
+        !mask->left->is<IR::Constant>() || !mask->right->is<IR::Constant>())
+        return -1;
+    auto value = mask->right->to<IR::Constant>()->value;
+    if (value < 0)
+        return -1;
+    unsigned length = bitcount(value);
+    if (length == 0)
+        return 0;
+    if (length > width || value != Util::maskFromSlice(width - 1, width - length))
+        return -1;
+    return length;
 }
 
 void EBPFTable::emitKeyType(CodeBuilder* builder) {
@@ -98,16 +185,32 @@ void EBPFTable::emitKeyType(CodeBuilder* builder) {
                 return;
             }
             unsigned width = ebpfType->to<IHasWidth>()->widthInBits();
+            if (c == lpmKey && width != 8 && width != 16 && width != 32 && width != 64) {
+                ::error(ErrorType::ERR_UNSUPPORTED,
+                        "%1%: LPM key fields must be 8, 16, 32 or 64 bits wide", c);
+                return;
+            }
             ordered.emplace(width, c);
             keyTypes.emplace(c, ebpfType);
             keyFieldNames.emplace(c, fieldName);
             fieldNumber++;
         }
 
-        // Emit key in decreasing order size - this way there will be no gaps
+        // Emit key in decreasing order size - this way there will be no gaps.
+        // The prefix of an LPM trie key covers the fields before the LPM
+        // field, so that one comes last.
+        std::vector<const IR::KeyElement*> fields;
         for (auto it = ordered.rbegin(); it != ordered.rend(); ++it) {
-            auto c = it->second;
+            if (it->second != lpmKey)
+                fields.push_back(it->second);
+        }
+        if (lpmKey != nullptr) {
+            fields.push_back(lpmKey);
+            builder->emitIndent();
+            builder->appendLine("u32 prefixlen;");
+        }
 
+        for (auto c : fields) {
             auto ebpfType = ::get(keyTypes, c);
             builder->emitIndent();
             cstring fieldName = ::get(keyFieldNames, c);
@@ -273,13 +376,15 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
         }
 
         cstring name = EBPFObject::externalName(table->container);
-        builder->target->emitTableDecl(builder, name, tableKind,
-                                       cstring("struct ") + keyTypeName,
-                                       cstring("struct ") + valueTypeName, size);
+        if (!inlinedEntries)
+            builder->target->emitTableDecl(builder, name, tableKind,
+                                           cstring("struct ") + keyTypeName,
+                                           cstring("struct ") + valueTypeName, size);
     }
-    builder->target->emitTableDecl(builder, defaultActionMapName, TableArray,
-                                   program->arrayIndexType,
-                                   cstring("struct ") + valueTypeName, 1);
+    if (!inlinedDefaultAction)
+        builder->target->emitTableDecl(builder, defaultActionMapName, TableArray,
+                                       program->arrayIndexType,
+                                       cstring("struct ") + valueTypeName, 1);
 }
 
 void EBPFTable::emitKey(CodeBuilder* builder, cstring keyName) {
@@ -299,7 +404,12 @@ void EBPFTable::emitKey(CodeBuilder* builder, cstring keyName) {
         }
 
         builder->emitIndent();
-        if (memcpy) {
+        if (c == lpmKey) {
+            // All the bits of the key are significant in a lookup
+            builder->appendFormat("LPM_KEY_SET(%s, %s, ", keyName.c_str(), fieldName.c_str());
+            codeGen->visit(c->expression);
+            builder->appendFormat(", %d)", width);
+        } else if (memcpy) {
             builder->appendFormat("memcpy(&%s.%s, &", keyName.c_str(), fieldName.c_str());
             codeGen->visit(c->expression);
             builder->appendFormat(", %d)", scalar->bytesRequired());
@@ -342,7 +452,176 @@ void EBPFTable::emitAction(CodeBuilder* builder, cstring valueName) {
     builder->blockEnd(true);
 }
 
+void EBPFTable::emitInlinedValue(CodeBuilder* builder, const IR::Expression* actionCall,
+                                 cstring valueName, cstring storageName) {
+    BUG_CHECK(actionCall->is<IR::MethodCallExpression>(),
+              "%1%: expected an action call", actionCall);
+    auto mce = actionCall->to<IR::MethodCallExpression>();
+    auto mi = P4::MethodInstance::resolve(mce, program->refMap, program->typeMap);
+    auto ac = mi->to<P4::ActionCall>();
+    BUG_CHECK(ac != nullptr, "%1%: expected an action call", mce);
+    cstring name = EBPFObject::externalName(ac->action);
+
+    builder->emitIndent();
+    builder->appendFormat("%s.action = %s", storageName.c_str(), name.c_str());
+    builder->endOfStatement(true);
+
+    CodeGenInspector cg(program->refMap, program->typeMap);
+    cg.setBuilder(builder);
+    for (auto p : *mi->substitution.getParametersInArgumentOrder()) {
+        auto arg = mi->substitution.lookup(p);
+        builder->emitIndent();
+        builder->appendFormat("%s.u.%s.%s = ", storageName.c_str(), name.c_str(),
+                              p->name.name.c_str());
+        arg->apply(cg);
+        builder->endOfStatement(true);
+    }
+
+    builder->emitIndent();
+    builder->appendFormat("%s = &%s", valueName.c_str(), storageName.c_str());
+    builder->endOfStatement(true);
+}
+
+// Exact entries become nested switch statements, one per key field,
+// which the compiler lowers to a binary search on the field values.
+void EBPFTable::emitSwitchTree(CodeBuilder* builder, cstring keyName, cstring valueName,
+                               cstring storageName, const std::vector<const IR::Entry*> &entries,
+                               size_t keyIndex) {
+    if (keyIndex == keyGenerator->keyElements.size()) {
+        // The first entry takes priority over any duplicate
+        emitInlinedValue(builder, entries.at(0)->getAction(), valueName, storageName);
+        return;
+    }
+
+    auto keyElement = keyGenerator->keyElements.at(keyIndex);
+    unsigned width = program->typeMap->getType(keyElement->expression)->to<IR::Type_Bits>()->size;
+
+    // Group entries by the value of this key field, keeping their order
+    std::vector<std::pair<const IR::Constant*, std::vector<const IR::Entry*>>> cases;
+    for (auto e : entries) {
+        auto value = e->getKeys()->components.at(keyIndex)->to<IR::Constant>();
+        auto it = std::find_if(cases.begin(), cases.end(),
+                               [value](const std::pair<const IR::Constant*,
+                                                       std::vector<const IR::Entry*>> &c) {
+                                   return c.first->value == value->value; });
+        if (it == cases.end())
+            cases.emplace_back(value, std::vector<const IR::Entry*>{e});
+        else
+            it->second.push_back(e);
+    }
+
+    builder->emitIndent();
+    builder->appendFormat("switch (%s.%s) ", keyName.c_str(),
+                          ::get(keyFieldNames, keyElement).c_str());
+    builder->blockStart();
+    for (auto &c : cases) {
+        builder->emitIndent();
+        builder->appendFormat("case %s: ", keyLiteral(c.first->value, width).c_str());
+        builder->blockStart();
+        emitSwitchTree(builder, keyName, valueName, storageName, c.second, keyIndex + 1);
+        builder->emitIndent();
+        builder->appendLine("break;");
+        builder->blockEnd(true);
+    }
+    builder->blockEnd(true);
+}
+
+// Entries with prefixes or don't care keys become a chain of tests,
+// longest LPM prefix first; entries with equal prefixes keep their order.
+void EBPFTable::emitDecisionList(CodeBuilder* builder, cstring keyName, cstring valueName,
+                                 cstring storageName) {
+    auto entries = table->container->getEntries();
+    auto lpmLength = [this](const IR::Entry* e) {
+        for (size_t i = 0; i < keyGenerator->keyElements.size(); i++) {
+            auto keyElement = keyGenerator->keyElements.at(i);
+            if (isLPM(program, keyElement))
+                return prefixLength(keyElement, e->getKeys()->components.at(i));
+        }
+        return 0;
+    };
+    std::vector<const IR::Entry*> ordered(entries->entries.begin(), entries->entries.end());
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [lpmLength](const IR::Entry* a, const IR::Entry* b) {
+                         return lpmLength(a) > lpmLength(b); });
+
+    builder->emitIndent();
+    bool first = true;
+    for (auto e : ordered) {
+        cstring condition = "";
+        for (size_t i = 0; i < keyGenerator->keyElements.size(); i++) {
+            auto keyElement = keyGenerator->keyElements.at(i);
+            auto entryKey = e->getKeys()->components.at(i);
+            unsigned width =
+                    program->typeMap->getType(keyElement->expression)->to<IR::Type_Bits>()->size;
+            int length = prefixLength(keyElement, entryKey);
+            if (length == 0)
+                continue;
+            cstring field = keyName + "." + ::get(keyFieldNames, keyElement);
+            if (!condition.isNullOrEmpty())
+                condition += " && ";
+            if (auto cst = entryKey->to<IR::Constant>()) {
+                condition += field + " == " + keyLiteral(cst->value, width);
+            } else {
+                auto mask = entryKey->to<IR::Mask>();
+                mpz_class maskValue = mask->right->to<IR::Constant>()->value;
+                mpz_class value = mask->left->to<IR::Constant>()->value & maskValue;
+                condition += cstring("(") + field + " & " + keyLiteral(maskValue, width) +
+                        ") == " + keyLiteral(value, width);
+            }
+        }
+
+        if (!first)
+            builder->append(" else ");
+        first = false;
+        if (condition.isNullOrEmpty()) {
+            // Matches any key: the remaining entries are unreachable
+            builder->blockStart();
+            emitInlinedValue(builder, e->getAction(), valueName, storageName);
+            builder->blockEnd(false);
+            break;
+        }
+        builder->appendFormat("if (%s) ", condition.c_str());
+        builder->blockStart();
+        emitInlinedValue(builder, e->getAction(), valueName, storageName);
+        builder->blockEnd(false);
+    }
+    builder->newline();
+}
+
+void EBPFTable::emitInlinedLookup(CodeBuilder* builder, cstring keyName,
+                                  cstring valueName, cstring storageName) {
+    BUG_CHECK(inlinedEntries, "%1%: entries are not constant", table->container);
+    auto entries = table->container->getEntries();
+    if (entries->size() == 0)
+        return;
+
+    bool exact = true;
+    for (auto e : entries->entries) {
+        for (auto k : e->getKeys()->components)
+            exact = exact && k->is<IR::Constant>();
+    }
+    if (exact) {
+        std::vector<const IR::Entry*> all(entries->entries.begin(), entries->entries.end());
+        emitSwitchTree(builder, keyName, valueName, storageName, all, 0);
+    } else {
+        emitDecisionList(builder, keyName, valueName, storageName);
+    }
+}
+
+void EBPFTable::emitInlinedDefaultAction(CodeBuilder* builder, cstring valueName,
+                                         cstring storageName) {
+    BUG_CHECK(inlinedDefaultAction, "%1%: default action is not constant", table->container);
+    emitInlinedValue(builder, table->container->getDefaultAction(), valueName, storageName);
+}
+
 void EBPFTable::emitInitializer(CodeBuilder* builder) {
+    if (!inlinedDefaultAction)
+        emitDefaultActionInitializer(builder);
+    if (!inlinedEntries)
+        emitEntriesInitializer(builder);
+}
+
+void EBPFTable::emitDefaultActionInitializer(CodeBuilder* builder) {
     // emit code to initialize the default action
     const IR::P4Table* t = table->container;
     const IR::Expression* defaultAction = t->getDefaultAction();
@@ -358,7 +637,6 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
     cstring fd = "tableFileDescriptor";
     cstring defaultTable = defaultActionMapName;
     cstring value = "value";
-    cstring key = "key";
 
     builder->emitIndent();
     builder->blockStart();
@@ -404,12 +682,55 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
                           defaultTable.c_str());
     builder->newline();
     builder->blockEnd(true);
+}
 
+// Sets the fields of an LPM trie key to the keys of a constant entry;
+// the other fields are exact, so the entry has a value for each of them.
+void EBPFTable::emitLPMEntryKey(CodeBuilder* builder, cstring keyName, const IR::Entry* entry) {
+    const auto &keys = entry->getKeys()->components;
+    for (size_t i = 0; i < keyGenerator->keyElements.size(); i++) {
+        auto keyElement = keyGenerator->keyElements.at(i);
+        auto entryKey = keys.at(i);
+        auto type = program->typeMap->getType(keyElement->expression)->to<IR::Type_Bits>();
+        int length = type == nullptr ? -1 : prefixLength(keyElement, entryKey);
+        if (length < 0 || !EBPFScalarType::generatesScalar(type->size) ||
+            (keyElement != lpmKey && !entryKey->is<IR::Constant>())) {
+            ::error(ErrorType::ERR_UNSUPPORTED, "%1%: unsupported key in an LPM table", entryKey);
+            return;
+        }
+        mpz_class value = 0;
+        if (auto cst = entryKey->to<IR::Constant>()) {
+            value = cst->value;
+        } else if (auto mask = entryKey->to<IR::Mask>()) {
+            value = mask->left->to<IR::Constant>()->value &
+                    mask->right->to<IR::Constant>()->value;
+        }
+        cstring fieldName = ::get(keyFieldNames, keyElement);
+        builder->emitIndent();
+        if (keyElement == lpmKey)
+            builder->appendFormat("LPM_KEY_SET(%s, %s, %s, %d)", keyName.c_str(),
+                                  fieldName.c_str(), keyLiteral(value, type->size).c_str(),
+                                  length);
+        else
+            builder->appendFormat("%s.%s = %s", keyName.c_str(), fieldName.c_str(),
+                                  keyLiteral(value, type->size).c_str());
+        builder->endOfStatement(true);
+    }
+}
+
+void EBPFTable::emitEntriesInitializer(CodeBuilder* builder) {
     // Emit code for table initializer
+    const IR::P4Table* t = table->container;
     auto entries = t->getEntries();
     if (entries == nullptr)
         return;
 
+    cstring fd = "tableFileDescriptor";
+    cstring value = "value";
+    cstring key = "key";
+    CodeGenInspector cg(program->refMap, program->typeMap);
+    cg.setBuilder(builder);
+
     builder->emitIndent();
     builder->blockStart();
     builder->emitIndent();
@@ -427,13 +748,19 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
 
         auto entryAction = e->getAction();
         builder->emitIndent();
-        builder->appendFormat("struct %s %s = {", keyTypeName.c_str(), key.c_str());
-        e->getKeys()->apply(cg);
-        builder->append("}");
-        builder->endOfStatement(true);
+        if (lpmKey != nullptr) {
+            builder->appendFormat("struct %s %s = {}", keyTypeName.c_str(), key.c_str());
+            builder->endOfStatement(true);
+            emitLPMEntryKey(builder, key, e);
+        } else {
+            builder->appendFormat("struct %s %s = {", keyTypeName.c_str(), key.c_str());
+            e->getKeys()->apply(cg);
+            builder->append("}");
+            builder->endOfStatement(true);
+        }
 
         BUG_CHECK(entryAction->is<IR::MethodCallExpression>(),
-                  "%1%: expected an action call", defaultAction);
+                  "%1%: expected an action call", entryAction);
         auto mce = entryAction->to<IR::MethodCallExpression>();
         auto mi = P4::MethodInstance::resolve(mce, program->refMap, program->typeMap);
 
@@ -484,7 +811,12 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
 
 EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternBlock* block,
                                    cstring name, CodeGenInspector* codeGen) :
-        EBPFTableBase(program, name, codeGen) {
+        EBPFTableBase(program, name, codeGen), isHash(false), isPerCPU(false) {
+    auto di = block->node->to<IR::Declaration_Instance>();
+    if (di != nullptr &&
+        di->getAnnotation(program->model.counterArray.percpu.name) != nullptr)
+        isPerCPU = true;
+
     auto sz = block->getParameterValue(program->model.counterArray.max_index.name);
     if (sz == nullptr || !sz->is<IR::Constant>()) {
         ::error(ErrorType::ERR_INVALID,
@@ -515,7 +847,11 @@ EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternB
 }
 
 void EBPFCounterTable::emitInstance(CodeBuilder* builder) {
-    TableKind kind = isHash ? TableHash : TableArray;
+    TableKind kind;
+    if (isPerCPU)
+        kind = isHash ? TablePerCPUHash : TablePerCPUArray;
+    else
+        kind = isHash ? TableHash : TableArray;
     builder->target->emitTableDecl(
         builder, dataMapName, kind, keyTypeName, valueTypeName, size);
 }
@@ -558,7 +894,11 @@ void EBPFCounterTable::emitCounterIncrement(CodeBuilder* builder,
     builder->newline();
     builder->increaseIndent();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, 1);", valueName.c_str());
+    // Each CPU owns its copy of a per-CPU counter, so no atomic operation is needed
+    if (isPerCPU)
+        builder->appendFormat("*%s += 1;", valueName.c_str());
+    else
+        builder->appendFormat("__sync_fetch_and_add(%s, 1);", valueName.c_str());
     builder->newline();
     builder->decreaseIndent();
 
@@ -621,7 +961,11 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->newline();
     builder->increaseIndent();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, %s);", valueName.c_str(), incName.c_str());
+    if (isPerCPU)
+        builder->appendFormat("*%s += %s;", valueName.c_str(), incName.c_str());
+    else
+        builder->appendFormat("__sync_fetch_and_add(%s, %s);",
+                              valueName.c_str(), incName.c_str());
     builder->newline();
     builder->decreaseIndent();
 
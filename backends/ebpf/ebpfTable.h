@@ -53,6 +53,16 @@ class EBPFTable final : public EBPFTableBase {
     cstring               actionEnumName;
     std::map<const IR::KeyElement*, cstring> keyFieldNames;
     std::map<const IR::KeyElement*, EBPFType*> keyTypes;
+    // Tables with a small list of constant entries are looked up by
+    // generated code instead of a map, and so is a constant default action.
+    bool                  inlinedEntries;
+    bool                  inlinedDefaultAction;
+    // The LPM field of a table whose entries are in an LPM trie map, or
+    // nullptr. The key of such a table starts with a prefix length and
+    // ends with this field, in network byte order.
+    const IR::KeyElement* lpmKey;
+    // Largest number of constant entries compiled into generated code
+    static const size_t   maxInlinedEntries = 64;
 
     EBPFTable(const EBPFProgram* program, const IR::TableBlock* table, CodeGenInspector* codeGen);
     void emitTypes(CodeBuilder* builder);
@@ -63,11 +73,31 @@ class EBPFTable final : public EBPFTableBase {
     void emitKey(CodeBuilder* builder, cstring keyName);
     void emitAction(CodeBuilder* builder, cstring valueName);
     void emitInitializer(CodeBuilder* builder);
+    // Sets valueName to point to storageName holding the value of the
+    // entry matching keyName; leaves valueName unchanged on a miss.
+    void emitInlinedLookup(CodeBuilder* builder, cstring keyName,
+                           cstring valueName, cstring storageName);
+    void emitInlinedDefaultAction(CodeBuilder* builder, cstring valueName, cstring storageName);
+
+ private:
+    bool canInlineEntries() const;
+    int prefixLength(const IR::KeyElement* keyElement, const IR::Expression* entryKey) const;
+    void emitInlinedValue(CodeBuilder* builder, const IR::Expression* actionCall,
+                          cstring valueName, cstring storageName);
+    void emitSwitchTree(CodeBuilder* builder, cstring keyName, cstring valueName,
+                        cstring storageName, const std::vector<const IR::Entry*> &entries,
+                        size_t keyIndex);
+    void emitDecisionList(CodeBuilder* builder, cstring keyName, cstring valueName,
+                          cstring storageName);
+    void emitDefaultActionInitializer(CodeBuilder* builder);
+    void emitEntriesInitializer(CodeBuilder* builder);
+    void emitLPMEntryKey(CodeBuilder* builder, cstring keyName, const IR::Entry* entry);
 };
 
 class EBPFCounterTable final : public EBPFTableBase {
     size_t    size;
     bool      isHash;
+    bool      isPerCPU;
  public:
     EBPFCounterTable(const EBPFProgram* program, const IR::ExternBlock* block,
                      cstring name, CodeGenInspector* codeGen);
@@ -19,6 +19,7 @@ limitations under the License.
  * It should be included with new target header files.
  */
 
+#include <stddef.h>     // offsetof
 #include <stdio.h>      // printf
 #include <linux/bpf.h>  // types, and general bpf definitions
 #include <stdbool.h>    // true and false
@@ -93,3 +94,19 @@ typedef unsigned long long u64;
 #define load_half(data, b) __constant_ntohs(*(u16 *)((u8*)(data) + (b)))
 #define load_word(data, b) __constant_ntohl(*(u32 *)((u8*)(data) + (b)))
 #define load_dword(data, b) __constant_ntohll(*(u64 *)((u8*)(data) + (b)))
+
+/*
+ * The keys of LPM trie maps start with a u32 prefix length, as struct
+ * bpf_lpm_trie_key does, followed by the data in network byte order.
+ * LPM_KEY_SET stores value in field, the last field of key, which is 8,
+ * 16, 32 or 64 bits wide. The prefix length covers all the fields before
+ * it and the first plen bits of it.
+ */
+#define LPM_KEY_HTON(value, size)                                   \
+    ((size) == 8 ? htonll(value) : (size) == 4 ? htonl(value) :     \
+     (size) == 2 ? htons(value) : (value))
+#define LPM_KEY_SET(key, field, value, plen) do {                   \
+    (key).field = LPM_KEY_HTON(value, sizeof((key).field));         \
+    (key).prefixlen =                                               \
+        (offsetof(__typeof__(key), field) - sizeof(u32)) * 8 + (plen); \
+} while (0)
@@ -185,6 +185,66 @@ static inline int bpf_obj_get(const char *pathname) {
     return syscall(__NR_bpf, BPF_OBJ_GET, &attr, sizeof(attr));
 }
 
+/**
+ * @brief Number of values a lookup of a per-CPU map returns.
+ * @details The kernel keeps one value per possible CPU, as listed in
+ * /sys/devices/system/cpu/possible (e.g. "0-7").
+ */
+static inline unsigned int bpf_num_possible_cpus(void) {
+    unsigned int first = 0, last = 0;
+    FILE *possible = fopen("/sys/devices/system/cpu/possible", "r");
+    if (possible == NULL)
+        return 1;
+    int fields = fscanf(possible, "%u-%u", &first, &last);
+    fclose(possible);
+    return fields == 2 ? last + 1 : first + 1;
+}
+
+/**
+ * @brief Read a counter as the sum of its values on all CPUs.
+ *
+ * @param fd File descriptor of the ebpf map object.
+ * @param key Pointer to the key.
+ * @param sum The counter; a single value unless the map is per-CPU.
+ *
+ * @return 0 if operation was successful, else an error code.
+ */
+static inline int bpf_read_counter(int fd, void *key, unsigned long long *sum) {
+    struct bpf_map_info info;
+    memset(&info, 0, sizeof(info));
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.info.bpf_fd = fd;
+    attr.info.info_len = sizeof(info);
+    attr.info.info = ptr_to_u64(&info);
+    int ret = syscall(__NR_bpf, BPF_OBJ_GET_INFO_BY_FD, &attr, sizeof(attr));
+    if (ret != 0)
+        return ret;
+    unsigned int num_cpus = 1;
+    if (info.type == BPF_MAP_TYPE_PERCPU_HASH || info.type == BPF_MAP_TYPE_PERCPU_ARRAY)
+        num_cpus = bpf_num_possible_cpus();
+    /* per-CPU values are padded to 8 bytes */
+    unsigned int stride = (info.value_size + 7) & ~7u;
+    unsigned char values[num_cpus * stride];
+    ret = bpf_lookup_elem(fd, key, values);
+    if (ret != 0)
+        return ret;
+    *sum = 0;
+    for (unsigned int cpu = 0; cpu < num_cpus; cpu++) {
+        const unsigned char *value = values + cpu * stride;
+        switch (info.value_size) {
+            case 1: *sum += *(const u8 *) value; break;
+            case 2: *sum += *(const u16 *) value; break;
+            case 4: *sum += *(const u32 *) value; break;
+            case 8: *sum += *(const u64 *) value; break;
+            default:
+                /* not a counter */
+                return -1;
+        }
+    }
+    return 0;
+}
+
 /** helper macro to place programs, maps, license in
  * different sections in elf_bpf file. Section names
  * are interpreted by elf_bpf loader
@@ -229,6 +289,8 @@ struct bpf_map_def SEC("maps") NAME = {          \
     bpf_map_update_elem(&table, key, value, flags)
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     bpf_update_elem(index, key, value, flags)
+#define BPF_USER_MAP_READ_COUNTER(index, key, value) \
+    bpf_read_counter(index, key, value)
 #define BPF_OBJ_PIN(table, name) bpf_obj_pin(table, name)
 #define BPF_OBJ_GET(name) bpf_obj_get(name)
 
@@ -16,6 +16,8 @@ limitations under the License.
 
 /*
 Implementation of userlevel eBPF map structure. Emulates the linux kernel bpf maps.
+Hash slots use linear probing and backward-shift deletion, so the tables never
+contain tombstones and lookups stop at the first empty slot.
 */
 
 #include <assert.h>
@@ -28,6 +30,33 @@ enum bpf_flags {
     USER_BPF_EXIST  // only update existing element
 };
 
+#define ALIGN_8(x) (((size_t)(x) + 7) & ~(size_t)7)
+#define SLOT_KEY(map, i) ((map)->slots + (size_t)(i) * (map)->slot_size)
+#define SLOT_VALUE(map, i) (SLOT_KEY(map, i) + ALIGN_8((map)->key_size))
+#define LPM_DATA_SIZE(map) ((map)->key_size - sizeof(struct bpf_lpm_trie_key))
+#define IS_PERCPU(map) ((map)->type == BPF_MAP_TYPE_PERCPU_HASH || \
+                        (map)->type == BPF_MAP_TYPE_PERCPU_ARRAY)
+
+/* Number of CPUs of per-CPU maps created from now on */
+static unsigned int num_possible_cpus = 1;
+/* The CPU the calling thread emulates */
+static __thread unsigned int current_cpu = 0;
+
+void bpf_set_num_possible_cpus(unsigned int num_cpus) {
+    num_possible_cpus = num_cpus ? num_cpus : 1;
+}
+
+void bpf_set_current_cpu(unsigned int cpu) {
+    current_cpu = cpu;
+}
+
+/* Returns the copy of a value which belongs to the current CPU */
+static unsigned char *this_cpu_value(const struct bpf_map *map, unsigned char *value) {
+    if (map->num_cpus == 1)
+        return value;
+    return value + (size_t)(current_cpu % map->num_cpus) * map->value_stride;
+}
+
 static int check_flags(void *elem, unsigned long long map_flags) {
     if (map_flags > USER_BPF_EXIST)
         /* unknown flags */
@@ -41,51 +70,329 @@ static int check_flags(void *elem, unsigned long long map_flags) {
     return EXIT_SUCCESS;
 }
 
-void *bpf_map_lookup_elem(struct bpf_map *map, void *key, unsigned int key_size) {
-    struct bpf_map *tmp_map;
-    HASH_FIND(hh, map, key, key_size, tmp_map);
-    if (tmp_map == NULL)
-        return NULL;
-    return tmp_map->value;
+/* FNV-1a followed by a final avalanche; 0 is reserved for empty slots. */
+static uint32_t hash_key(const void *key, unsigned int key_size) {
+    const unsigned char *bytes = key;
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < key_size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash ? hash : 1;
 }
 
-int bpf_map_update_elem(struct bpf_map **map, void *key, unsigned int key_size, void *value, unsigned int value_size, unsigned long long flags) {
-    struct bpf_map *tmp_map;
-    HASH_FIND(hh, *map, key, key_size, tmp_map);
-    int ret = check_flags(tmp_map, flags);
+/*
+ * Returns the slot holding the key if it is present and sets *found,
+ * otherwise returns the empty slot where the key would be inserted.
+ */
+static uint32_t hash_probe(const struct bpf_map *map, const void *key,
+                           uint32_t hash, int *found) {
+    uint32_t i = hash & map->mask;
+    while (map->hashes[i] != 0) {
+        if (map->hashes[i] == hash &&
+            memcmp(SLOT_KEY(map, i), key, map->key_size) == 0) {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & map->mask;
+    }
+    *found = 0;
+    return i;
+}
+
+static void *hash_lookup(const struct bpf_map *map, const void *key) {
+    int found;
+    uint32_t i = hash_probe(map, key, hash_key(key, map->key_size), &found);
+    return found ? SLOT_VALUE(map, i) : NULL;
+}
+
+static int hash_update(struct bpf_map *map, const void *key, const void *value,
+                       unsigned long long flags) {
+    int found;
+    uint32_t hash = hash_key(key, map->key_size);
+    uint32_t i = hash_probe(map, key, hash, &found);
+    int ret = check_flags(found ? SLOT_VALUE(map, i) : NULL, flags);
     if (ret)
         return ret;
-    if (tmp_map == NULL) {
-        tmp_map = (struct bpf_map *) malloc(sizeof(struct bpf_map));
-        tmp_map->key = malloc(key_size);
-        memcpy(tmp_map->key, key, key_size);
-        HASH_ADD_KEYPTR(hh, *map, tmp_map->key, key_size, tmp_map);
-    }
-    tmp_map->value = malloc(value_size);
-    memcpy(tmp_map->value, value, value_size);
+    if (!found) {
+        if (map->count >= map->max_entries)
+            /* map is full */
+            return EXIT_FAILURE;
+        map->hashes[i] = hash;
+        memcpy(SLOT_KEY(map, i), key, map->key_size);
+        /* the values of all other CPUs start at zero */
+        if (map->num_cpus > 1)
+            memset(SLOT_VALUE(map, i), 0, map->num_cpus * map->value_stride);
+        map->count++;
+    }
+    memcpy(this_cpu_value(map, SLOT_VALUE(map, i)), value, map->value_size);
     return EXIT_SUCCESS;
 }
 
-int bpf_map_delete_elem(struct bpf_map *map, void *key, unsigned int key_size) {
-    struct bpf_map *tmp_map;
-    HASH_FIND(hh, map, key, key_size, tmp_map);
-    if (tmp_map != NULL) {
-        HASH_DEL(map, tmp_map);
-        free(tmp_map->value);
-        free(tmp_map->key);
-        free(tmp_map);
+static int hash_delete(struct bpf_map *map, const void *key) {
+    int found;
+    uint32_t i = hash_probe(map, key, hash_key(key, map->key_size), &found);
+    if (!found)
+        return EXIT_FAILURE;
+    /* Shift back every following entry which would not be found anymore
+     * once slot i is empty, i.e., whose home slot is not in (i, j]. */
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & map->mask;
+        if (map->hashes[j] == 0)
+            break;
+        uint32_t home = map->hashes[j] & map->mask;
+        if (((j - home) & map->mask) >= ((j - i) & map->mask)) {
+            map->hashes[i] = map->hashes[j];
+            memcpy(SLOT_KEY(map, i), SLOT_KEY(map, j), map->slot_size);
+            i = j;
+        }
     }
+    map->hashes[i] = 0;
+    map->count--;
     return EXIT_SUCCESS;
 }
 
-int bpf_map_delete_map(struct bpf_map *map) {
-    struct bpf_map *curr_map, *tmp_map;
-    HASH_ITER(hh, map, curr_map, tmp_map) {
-        HASH_DEL(map, curr_map);
-        free(curr_map->value);
-        free(curr_map->key);
-        free(curr_map);
+static void *array_lookup(const struct bpf_map *map, const void *key) {
+    uint32_t index = *(const uint32_t *) key;
+    if (index >= map->max_entries)
+        return NULL;
+    return map->slots + (size_t)index * map->slot_size;
+}
+
+static int array_update(struct bpf_map *map, const void *key, const void *value,
+                        unsigned long long flags) {
+    if (flags > USER_BPF_EXIST)
+        /* unknown flags */
+        return EXIT_FAILURE;
+    if (flags == USER_BPF_NOEXIST)
+        /* all elements always exist */
+        return EXIT_FAILURE;
+    unsigned char *elem = array_lookup(map, key);
+    if (elem == NULL)
+        /* index out of bounds */
+        return EXIT_FAILURE;
+    memcpy(this_cpu_value(map, elem), value, map->value_size);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Copies the key with prefix length prefixlen into masked, clearing all
+ * the data bits beyond the prefix so that equal prefixes hash equally.
+ */
+static void lpm_mask_key(const struct bpf_map *map, const void *key,
+                         uint32_t prefixlen, unsigned char *masked) {
+    const struct bpf_lpm_trie_key *src = key;
+    struct bpf_lpm_trie_key *dst = (struct bpf_lpm_trie_key *) masked;
+    unsigned int data_size = LPM_DATA_SIZE(map);
+    unsigned int full_bytes = prefixlen / 8;
+    unsigned int rem_bits = prefixlen % 8;
+    dst->prefixlen = prefixlen;
+    memcpy(dst->data, src->data, full_bytes);
+    memset(dst->data + full_bytes, 0, data_size - full_bytes);
+    if (rem_bits)
+        dst->data[full_bytes] = src->data[full_bytes] & (unsigned char)(0xff << (8 - rem_bits));
+}
+
+static void *lpm_lookup(const struct bpf_map *map, const void *key) {
+    unsigned char masked[map->key_size];
+    uint32_t max_prefixlen = LPM_DATA_SIZE(map) * 8;
+    uint32_t prefixlen = ((const struct bpf_lpm_trie_key *) key)->prefixlen;
+    if (prefixlen > max_prefixlen)
+        prefixlen = max_prefixlen;
+    /* Only probe for prefix lengths which are actually in use */
+    for (long plen = prefixlen; plen >= 0; plen--) {
+        if (map->prefixes[plen] == 0)
+            continue;
+        lpm_mask_key(map, key, plen, masked);
+        void *value = hash_lookup(map, masked);
+        if (value != NULL)
+            return value;
     }
+    return NULL;
+}
+
+static int lpm_update(struct bpf_map *map, const void *key, const void *value,
+                      unsigned long long flags) {
+    unsigned char masked[map->key_size];
+    uint32_t prefixlen = ((const struct bpf_lpm_trie_key *) key)->prefixlen;
+    if (prefixlen > LPM_DATA_SIZE(map) * 8)
+        return EXIT_FAILURE;
+    lpm_mask_key(map, key, prefixlen, masked);
+    unsigned int count = map->count;
+    int ret = hash_update(map, masked, value, flags);
+    if (ret == EXIT_SUCCESS && map->count != count)
+        map->prefixes[prefixlen]++;
+    return ret;
+}
+
+static int lpm_delete(struct bpf_map *map, const void *key) {
+    unsigned char masked[map->key_size];
+    uint32_t prefixlen = ((const struct bpf_lpm_trie_key *) key)->prefixlen;
+    if (prefixlen > LPM_DATA_SIZE(map) * 8)
+        return EXIT_FAILURE;
+    lpm_mask_key(map, key, prefixlen, masked);
+    int ret = hash_delete(map, masked);
+    if (ret == EXIT_SUCCESS)
+        map->prefixes[prefixlen]--;
+    return ret;
+}
+
+struct bpf_map *bpf_map_create(unsigned int type, unsigned int key_size,
+                               unsigned int value_size, unsigned int max_entries) {
+    if (key_size == 0 || value_size == 0 || max_entries == 0) {
+        fprintf(stderr, "Error: Invalid map parameters\n");
+        return NULL;
+    }
+    if (type == BPF_MAP_TYPE_LPM_TRIE && key_size <= sizeof(struct bpf_lpm_trie_key)) {
+        fprintf(stderr, "Error: LPM trie maps require a key larger than %zu bytes\n",
+                sizeof(struct bpf_lpm_trie_key));
+        return NULL;
+    }
+    if ((type == BPF_MAP_TYPE_ARRAY || type == BPF_MAP_TYPE_PERCPU_ARRAY) &&
+        key_size != sizeof(uint32_t)) {
+        fprintf(stderr, "Error: Array maps require a key of size %zu\n", sizeof(uint32_t));
+        return NULL;
+    }
+    if (type != BPF_MAP_TYPE_HASH && type != BPF_MAP_TYPE_ARRAY &&
+        type != BPF_MAP_TYPE_LPM_TRIE && type != BPF_MAP_TYPE_PERCPU_HASH &&
+        type != BPF_MAP_TYPE_PERCPU_ARRAY) {
+        fprintf(stderr, "Error: Unsupported map type %u\n", type);
+        return NULL;
+    }
+
+    struct bpf_map *map = calloc(1, sizeof(struct bpf_map));
+    if (!map)
+        return NULL;
+    map->type = type;
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->max_entries = max_entries;
+    /* As in the kernel, each per-CPU copy of a value is padded to 8 bytes */
+    map->num_cpus = IS_PERCPU(map) ? num_possible_cpus : 1;
+    map->value_stride = ALIGN_8(value_size);
+
+    if (type == BPF_MAP_TYPE_ARRAY || type == BPF_MAP_TYPE_PERCPU_ARRAY) {
+        /* Array elements always exist and are zero-initialized */
+        map->slot_size = map->num_cpus * map->value_stride;
+        map->slots = calloc(max_entries, map->slot_size);
+        if (!map->slots) {
+            free(map);
+            return NULL;
+        }
+        map->count = max_entries;
+        return map;
+    }
+
+    /* Keep the load factor at or below one half */
+    size_t capacity = 8;
+    while (capacity < 2 * (size_t)max_entries)
+        capacity <<= 1;
+    if (capacity > UINT32_MAX) {
+        fprintf(stderr, "Error: Map size %u too large\n", max_entries);
+        free(map);
+        return NULL;
+    }
+    map->mask = (uint32_t)(capacity - 1);
+    map->slot_size = ALIGN_8(key_size) + map->num_cpus * map->value_stride;
+    map->hashes = calloc(capacity, sizeof(uint32_t));
+    map->slots = malloc(capacity * map->slot_size);
+    if (type == BPF_MAP_TYPE_LPM_TRIE)
+        map->prefixes = calloc(LPM_DATA_SIZE(map) * 8 + 1, sizeof(unsigned int));
+    if (!map->hashes || !map->slots ||
+        (type == BPF_MAP_TYPE_LPM_TRIE && !map->prefixes)) {
+        bpf_map_delete_map(map);
+        return NULL;
+    }
+    return map;
+}
+
+/* Returns the base of the value of a key; for per-CPU maps the values of
+   all CPUs follow each other, starting with the value of CPU 0. */
+static unsigned char *lookup_values(struct bpf_map *map, const void *key) {
+    switch (map->type) {
+        case BPF_MAP_TYPE_ARRAY:
+        case BPF_MAP_TYPE_PERCPU_ARRAY:
+            return array_lookup(map, key);
+        case BPF_MAP_TYPE_LPM_TRIE:
+            return lpm_lookup(map, key);
+        default:
+            return hash_lookup(map, key);
+    }
+}
+
+void *bpf_map_lookup_elem(struct bpf_map *map, const void *key) {
+    unsigned char *values = lookup_values(map, key);
+    if (values == NULL)
+        return NULL;
+    return this_cpu_value(map, values);
+}
+
+int bpf_map_lookup_elem_percpu(struct bpf_map *map, const void *key, void *values) {
+    unsigned char *elem = lookup_values(map, key);
+    if (elem == NULL)
+        return EXIT_FAILURE;
+    for (unsigned int cpu = 0; cpu < map->num_cpus; cpu++)
+        memcpy((unsigned char *)values + cpu * map->value_stride,
+               elem + cpu * map->value_stride, map->value_size);
+    return EXIT_SUCCESS;
+}
+
+int bpf_map_sum_elem(struct bpf_map *map, const void *key, unsigned long long *sum) {
+    unsigned char values[map->num_cpus * map->value_stride];
+    if (bpf_map_lookup_elem_percpu(map, key, values) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    *sum = 0;
+    for (unsigned int cpu = 0; cpu < map->num_cpus; cpu++) {
+        const unsigned char *value = values + cpu * map->value_stride;
+        switch (map->value_size) {
+            case 1: *sum += *(const uint8_t *) value; break;
+            case 2: *sum += *(const uint16_t *) value; break;
+            case 4: *sum += *(const uint32_t *) value; break;
+            case 8: *sum += *(const uint64_t *) value; break;
+            default:
+                /* not a counter */
+                return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int bpf_map_update_elem(struct bpf_map *map, const void *key, const void *value,
+                        unsigned long long flags) {
+    switch (map->type) {
+        case BPF_MAP_TYPE_ARRAY:
+        case BPF_MAP_TYPE_PERCPU_ARRAY:
+            return array_update(map, key, value, flags);
+        case BPF_MAP_TYPE_LPM_TRIE:
+            return lpm_update(map, key, value, flags);
+        default:
+            return hash_update(map, key, value, flags);
+    }
+}
+
+int bpf_map_delete_elem(struct bpf_map *map, const void *key) {
+    switch (map->type) {
+        case BPF_MAP_TYPE_ARRAY:
+        case BPF_MAP_TYPE_PERCPU_ARRAY:
+            /* array elements cannot be deleted */
+            return EXIT_FAILURE;
+        case BPF_MAP_TYPE_LPM_TRIE:
+            return lpm_delete(map, key);
+        default:
+            return hash_delete(map, key);
+    }
+}
+
+int bpf_map_delete_map(struct bpf_map *map) {
+    if (map == NULL)
+        return EXIT_SUCCESS;
+    free(map->prefixes);
+    free(map->slots);
+    free(map->hashes);
     free(map);
     return EXIT_SUCCESS;
 }
@@ -15,53 +15,125 @@ limitations under the License.
 */
 
 /*
- * This file defines a library of simple hashmap operations which emulate the behavior
- * of the kernel ebpf map API. This library is currently not thread-safe.
+ * This file defines a library of simple map operations which emulate the behavior
+ * of the kernel ebpf map API. All storage of a map is allocated when the map
+ * is created and is bounded by max_entries, as it is in the kernel.
+ * Hash maps are open-addressing tables with keys and values stored inline,
+ * array maps are flat arrays of values, and LPM trie maps are emulated with one
+ * hash probe per prefix length in use. Per-CPU maps store one copy of each
+ * value per emulated CPU; each thread selects the CPU it emulates.
+ * This library is currently not thread-safe, except for concurrent lookups
+ * and updates of existing elements of per-CPU maps from distinct CPUs.
  */
 
 #ifndef BACKENDS_EBPF_RUNTIME_EBPF_MAP_H_
 #define BACKENDS_EBPF_RUNTIME_EBPF_MAP_H_
 
-#include "contrib/uthash.h"  // exports string.h, stddef.h, and stdlib.h
+#include <stddef.h>     // size_t
+#include <stdint.h>     // uint32_t
+#include <stdlib.h>     // malloc(), EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>     // memcpy(), memcmp()
+#include <linux/bpf.h>  // BPF_MAP_TYPE_*, struct bpf_lpm_trie_key
 
 struct bpf_map {
-    void *key;
-    void *value;
-    UT_hash_handle hh;  // makes this structure hashable
+    unsigned int type;          // BPF_MAP_TYPE_{HASH,ARRAY,LPM_TRIE,PERCPU_HASH,PERCPU_ARRAY}
+    unsigned int key_size;      // size of the key structure
+    unsigned int value_size;    // size of the value structure
+    unsigned int max_entries;   // maximum number of entries
+    unsigned int count;         // number of entries currently stored
+    unsigned int num_cpus;      // copies of each value, 1 unless per-CPU
+    size_t value_stride;        // value size padded to 8 bytes
+    uint32_t mask;              // number of hash slots - 1 (power of two)
+    size_t slot_size;           // key and all values, each padded to 8 bytes
+    uint32_t *hashes;           // hash of each slot, 0 if the slot is empty
+    unsigned char *slots;       // inline keys and values
+    unsigned int *prefixes;     // LPM trie only: entry count per prefix length
 };
 
+/**
+ * @brief Set the number of CPUs of per-CPU maps.
+ * @details Applies to the per-CPU maps created after the call. Defaults to 1.
+ */
+void bpf_set_num_possible_cpus(unsigned int num_cpus);
+
+/**
+ * @brief Set the CPU emulated by the calling thread.
+ * @details Lookups and updates of per-CPU maps by this thread access the
+ * value of this CPU, as a program running on that CPU would. Defaults to 0.
+ */
+void bpf_set_current_cpu(unsigned int cpu);
+
+/**
+ * @brief Create a new map.
+ * @details Allocates all the memory that the map is ever going to use.
+ * Supported types are BPF_MAP_TYPE_HASH, BPF_MAP_TYPE_ARRAY,
+ * BPF_MAP_TYPE_LPM_TRIE, BPF_MAP_TYPE_PERCPU_HASH and
+ * BPF_MAP_TYPE_PERCPU_ARRAY. As in the kernel, array maps require a 4 byte key
+ * and LPM trie maps require a key starting with struct bpf_lpm_trie_key.
+ *
+ * @return NULL if the parameters are invalid or memory is exhausted.
+ */
+struct bpf_map *bpf_map_create(unsigned int type, unsigned int key_size,
+                               unsigned int value_size, unsigned int max_entries);
+
 /**
  * @brief Add/Update a value in the map
  * @details Updates a value in the map based on the provided key.
  * If the key does not exist, it depends the provided flags if the
  * element is added or the operation is rejected.
+ * The operation is also rejected if the map already holds max_entries.
+ * For per-CPU maps only the value of the current CPU is updated; the
+ * values of the other CPUs of a new element are zero.
  *
  * @return EXIT_FAILURE if update operation fails
  */
-int bpf_map_update_elem(struct bpf_map **map, void *key, unsigned int key_size, void *value,unsigned int value_size, unsigned long long flags);
+int bpf_map_update_elem(struct bpf_map *map, const void *key, const void *value,
+                        unsigned long long flags);
 
 /**
  * @brief Find a value based on a key.
  * @details Provides a pointer to a value in the map based on the provided key.
- * If the key does not exist, NULL is returned.
+ * If the key does not exist, NULL is returned. For LPM trie maps the value
+ * of the longest prefix matching the key data is returned. For per-CPU maps
+ * the value of the current CPU is returned.
  *
  * @return NULL if key does not exist
  */
-void *bpf_map_lookup_elem(struct bpf_map *map, void *key, unsigned int key_size);
+void *bpf_map_lookup_elem(struct bpf_map *map, const void *key);
+
+/**
+ * @brief Copy the values of all CPUs of a key.
+ * @details Emulates a lookup from user space: values must have room for
+ * one value per CPU, each padded to a multiple of 8 bytes.
+ * Maps which are not per-CPU have a single CPU.
+ *
+ * @return EXIT_FAILURE if key does not exist
+ */
+int bpf_map_lookup_elem_percpu(struct bpf_map *map, const void *key, void *values);
+
+/**
+ * @brief Read a counter as the sum of its values on all CPUs.
+ * @details Interprets the values as unsigned integers of the value size,
+ * which must be 1, 2, 4 or 8 bytes.
+ *
+ * @return EXIT_FAILURE if key does not exist or the value is not an integer
+ */
+int bpf_map_sum_elem(struct bpf_map *map, const void *key, unsigned long long *sum);
 
 /**
  * @brief Delete key and value from the map.
  * @details Deletes the key and the corresponding value from the map.
- * If the key does not exist, no operation is performed.
+ * If the key does not exist, no operation is performed and, as in the
+ * kernel, the operation fails. Array map elements cannot be deleted.
  *
  * @return EXIT_FAILURE if operation fails.
  */
-int bpf_map_delete_elem(struct bpf_map *map, void *key, unsigned int key_size);
+int bpf_map_delete_elem(struct bpf_map *map, const void *key);
 
 /**
  * @brief Delete the entire map at once.
  * @details Deletes all the keys and values in the map.
- * Also frees all the values allocated with the map.
+ * Also frees all the memory allocated with the map.
  *
  * @return EXIT_FAILURE if operation fails.
  */
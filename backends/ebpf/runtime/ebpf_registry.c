@@ -19,6 +19,7 @@ Implementation of ebpf registry. Intended to provide a common access interface b
 */
 
 #include <stdio.h>
+#include "contrib/uthash.h"
 #include "ebpf_registry.h"
 
 /**
@@ -62,6 +63,12 @@ int registry_add(struct bpf_table *tbl) {
         fprintf(stderr, "Error: Key name %s exceeds maximum size %d", tbl->name, MAX_TABLE_NAME_LENGTH);
         return EXIT_FAILURE;
     }
+    /* Allocate the storage of the table */
+    tbl->bpf_map = bpf_map_create(tbl->type, tbl->key_size, tbl->value_size, tbl->max_entries);
+    if (!tbl->bpf_map) {
+        fprintf(stderr, "Error: Could not create map for table %s\n", tbl->name);
+        return EXIT_FAILURE;
+    }
     /* Add the table */
     tmp_reg = malloc(sizeof(registry_entry));
     if (!tmp_reg) {
@@ -84,6 +91,7 @@ void registry_delete() {
     HASH_ITER(h_name, reg_tables_name, curr_tbl, tmp_tbl) {
         HASH_DELETE(h_name, reg_tables_name, curr_tbl);
         bpf_map_delete_map(curr_tbl->tbl->bpf_map);
+        curr_tbl->tbl->bpf_map = NULL;
         free(curr_tbl);
     }
     curr_tbl = NULL;
@@ -97,6 +105,7 @@ int registry_delete_tbl(const char *name) {
     registry_entry *tmp_reg = find_register(name);
     if (tmp_reg != NULL) {
         bpf_map_delete_map(tmp_reg->tbl->bpf_map);
+        tmp_reg->tbl->bpf_map = NULL;
         HASH_DELETE(h_name, reg_tables_name, tmp_reg);
         HASH_DELETE(h_id, reg_tables_id, tmp_reg);
         free(tmp_reg);
@@ -125,8 +134,7 @@ int registry_update_table(const char *name, void *key, void *value, unsigned lon
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    bpf_map_update_elem(&tmp_tbl->bpf_map, key, tmp_tbl->key_size, value, tmp_tbl->value_size, flags);
-    return EXIT_SUCCESS;
+    return bpf_map_update_elem(tmp_tbl->bpf_map, key, value, flags);
 }
 
 int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long long flags) {
@@ -134,8 +142,7 @@ int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long l
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    bpf_map_update_elem(&tmp_tbl->bpf_map, key, tmp_tbl->key_size, value, tmp_tbl->value_size, flags);
-    return EXIT_SUCCESS;
+    return bpf_map_update_elem(tmp_tbl->bpf_map, key, value, flags);
 }
 
 void *registry_lookup_table_elem(const char *name, void *key) {
@@ -143,8 +150,7 @@ void *registry_lookup_table_elem(const char *name, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return NULL;
-    if (tmp_tbl->bpf_map)
-    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);
+    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key);
 }
 
 void *registry_lookup_table_elem_id(int tbl_id, void *key) {
@@ -152,8 +158,15 @@ void *registry_lookup_table_elem_id(int tbl_id, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return NULL;
-    if (tmp_tbl->bpf_map)
-    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);
+    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key);
+}
+
+int registry_read_counter_id(int tbl_id, void *key, unsigned long long *value) {
+    struct bpf_table *tmp_tbl = registry_lookup_table_id(tbl_id);
+    if (tmp_tbl == NULL)
+        /* not found, return */
+        return EXIT_FAILURE;
+    return bpf_map_sum_elem(tmp_tbl->bpf_map, key, value);
 }
 
 int registry_get_id(const char *name) {
@@ -32,26 +32,28 @@ limitations under the License.
  * @brief A helper structure used to describe attributes.
  * @details This structure describes various properties of the ebpf table
  * such as key and value size and the maximum amount of entries possible.
- * In userspace, this space is theoretically unlimited.
- * This table definition points to an actual hashmap managed by uthash,
+ * As in the kernel, all entries are preallocated when the table is added
+ * to the registry, so max_entries bounds the memory used by the table.
+ * This table definition points to an actual map created by bpf_map_create,
  * the relation is many-to-one.
  * "name" should not exceed VAR_SIZE. Functions using bpf_table also assume
  * that "name" is a conventional null-terminated string.
  */
 struct bpf_table {
     char *name;                 // table name longer than VAR_SIZE is not accessed
-    unsigned int type;          // currently only hashmap is supported
+    unsigned int type;          // hash, array, or LPM trie (BPF_MAP_TYPE_*)
     unsigned int key_size;      // size of the key structure
     unsigned int value_size;    // size of the value structure
     unsigned int max_entries;   // Maximum of possible entries
-    struct bpf_map *bpf_map;    // Pointer to the actual hash map
+    struct bpf_map *bpf_map;    // Pointer to the actual map
 };
 
 /**
  * @brief Adds a new table to the registry.
  * @details Adds a new table to the shared registry and assigns
  * an id to it. This operation uses a char name stored in "table" as a key.
-  * @return EXIT_FAILURE if map already exists or cannot be added.
+ * The underlying map is created with the type and sizes of the table.
+ * @return EXIT_FAILURE if map already exists or cannot be added.
  */
 int registry_add(struct bpf_table *tbl);
 
@@ -101,7 +103,7 @@ int registry_get_id(const char *name);
  * If the map can be found and exists, this function calls
  * the bpf_map_update_elem function to insert an entry.
  * This operation uses a char name as the key.
- * @return EXIT_FAILURE if map cannot be found.
+ * @return EXIT_FAILURE if map cannot be found or the update fails.
  */
 int registry_update_table(const char *name, void *key, void *value, unsigned long long flags);
 
@@ -111,7 +113,7 @@ int registry_update_table(const char *name, void *key, void *value, unsigned lon
  * If the map can be found and exists, this function calls
  * the bpf_map_update_elem function to insert an entry.
  * This operation uses an integer as the key.
- * @return EXIT_FAILURE if map cannot be found.
+ * @return EXIT_FAILURE if map cannot be found or the update fails.
  */
 int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long long flags);
 
@@ -137,4 +139,14 @@ void *registry_lookup_table_elem(const char *name, void *key);
  */
 void *registry_lookup_table_elem_id(int tbl_id, void *key);
 
+/**
+ * @brief Read a counter from a bpf map through the registry.
+ * @details A wrapper function to read an integer value from a map
+ * where only the name is known. For per-CPU maps the values of all
+ * CPUs are added up, as a user space reader of a kernel map would do.
+ * This operation uses an integer as the key.
+ * @return EXIT_FAILURE if the map or the value cannot be found.
+ */
+int registry_read_counter_id(int tbl_id, void *key, unsigned long long *value);
+
 #endif  // BACKENDS_EBPF_RUNTIME_EBPF_REGISTRY_H_
@@ -32,8 +32,12 @@ limitations under the License.
 
 #define PCAPIN  "_in.pcap"
 #define DELIM   '_'
+#define MAX_BENCH_THREADS 256
 
 static int debug = 0;
+static int benchmark = 0;
+static int num_threads = 1;
+static int iterations = 1;
 
 void usage(char *name) {
     fprintf(stderr, "This program expects a pcap file pattern, "
@@ -42,10 +46,18 @@ void usage(char *name) {
             "then feeds the individual packets into a filter function, "
             "and returns the output.\n");
     fprintf(stderr, "Usage: %s [-d] -f file.pcap -n num_pcaps\n", name);
+    fprintf(stderr, "       %s [-d] -b -f file.pcap [-t num_threads] [-i iterations]\n", name);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "\t-d: Turn on debug messages\n");
     fprintf(stderr, "\t-f: The input pcap file\n");
     fprintf(stderr, "\t-n: Specifies the number of input pcap files\n");
+    fprintf(stderr, "\t-b: Benchmark mode: run the filter over all packets of the "
+            "exact input file and report the throughput without writing any output\n");
+    fprintf(stderr, "\t-t: Benchmark mode: number of threads processing disjoint "
+            "packet ranges (default 1). Tables are shared and not synchronized, so "
+            "programs which insert into tables should be measured with one thread; "
+            "per-CPU counter arrays are safe\n");
+    fprintf(stderr, "\t-i: Benchmark mode: number of passes over the input (default 1)\n");
     exit(EXIT_FAILURE);
 }
 
@@ -97,11 +109,30 @@ int main(int argc, char **argv) {
     int c;
     opterr = 0;
 
-    while ((c = getopt (argc, argv, "dn:f:")) != -1) {
+    while ((c = getopt (argc, argv, "dbn:f:t:i:")) != -1) {
         switch (c) {
             case 'd':
             debug = 1;
             break;
+            case 'b':
+            benchmark = 1;
+            break;
+            case 't':
+                num_threads = (int)strtol(optarg, (char **)NULL, 10);
+                if (num_threads < 1 || num_threads > MAX_BENCH_THREADS) {
+                    fprintf(stderr,
+                        "Number of threads out of bounds! Maximum is %d\n",
+                        MAX_BENCH_THREADS);
+                    return EXIT_FAILURE;
+                }
+            break;
+            case 'i':
+                iterations = (int)strtol(optarg, (char **)NULL, 10);
+                if (iterations < 1) {
+                    fprintf(stderr, "Number of iterations must be positive\n");
+                    return EXIT_FAILURE;
+                }
+            break;
             case 'n':
                 num_pcaps = (int)strtol(optarg, (char **)NULL, 10);
                 if (num_pcaps < 0 || num_pcaps > UINT16_MAX) {
@@ -131,9 +162,11 @@ int main(int argc, char **argv) {
     }
 
     /* Check if there was actually any file or number input */
-    if (!pcap_name || num_pcaps == -1)
+    if (!pcap_name || (num_pcaps == -1 && !benchmark))
         usage(argv[0]);
 
+    /* In benchmark mode every thread emulates a CPU of the per-CPU maps */
+    SET_NUM_CPUS(benchmark ? num_threads : 1);
     INIT_EBPF_TABLES(debug);
 #ifdef CONTROL_PLANE
     /* Set the default action for the userspace hash tables */
@@ -142,7 +175,16 @@ int main(int argc, char **argv) {
     setup_control_plane();
 #endif
 
-    launch_runtime(pcap_name, num_pcaps);
+    int ret = EXIT_SUCCESS;
+    if (benchmark)
+        ret = BENCHMARK(ebpf_filter, argv[0], pcap_name, num_threads, iterations, debug);
+    else
+        launch_runtime(pcap_name, num_pcaps);
+#ifdef CONTROL_PLANE
+    /* Compare the counters with the values expected by the control file */
+    if (ret == EXIT_SUCCESS && !benchmark)
+        ret = check_counters();
+#endif
     DELETE_EBPF_TABLES(debug);
-    return EXIT_SUCCESS;
+    return ret;
 }
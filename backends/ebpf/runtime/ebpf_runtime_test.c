@@ -18,10 +18,24 @@ limitations under the License.
 #include <ctype.h>      // isprint()
 #include <string.h>     // memcpy()
 #include <stdlib.h>     // malloc()
+#include <pthread.h>    // pthread_create()
+#include <time.h>       // clock_gettime()
 #include "ebpf_test.h"
 #include "ebpf_runtime_test.h"
 
 #define PCAPOUT "_out.pcap"
+#define BENCH_BATCH_SIZE 64     // packets handed to the filter per batch
+
+/* The range of packets a benchmark thread processes */
+typedef struct {
+    packet_filter ebpf_filter;
+    const pcap_pkt_ref *pkts;
+    unsigned int cpu;
+    uint32_t start;
+    uint32_t end;
+    int iterations;
+    uint64_t accepted;
+} bench_range_t;
 
 /**
  * @brief Feed a list packets into an eBPF program.
@@ -80,6 +94,100 @@ void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pc
     delete_array(output_array);
 }
 
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @brief Run the filter over a range of packets of a mapped pcap file.
+ * @details The descriptors of a batch of packets are set up first and the
+ * filter is then invoked back-to-back on the whole batch. The packet data
+ * is used in place and nothing is allocated or copied per packet.
+ */
+static void *feed_packet_range(void *arg) {
+    bench_range_t *range = arg;
+    struct sk_buff batch[BENCH_BATCH_SIZE];
+    uint64_t accepted = 0;
+    /* Each thread emulates its own CPU for per-CPU maps */
+    bpf_set_current_cpu(range->cpu);
+    for (int it = 0; it < range->iterations; it++) {
+        for (uint32_t i = range->start; i < range->end; i += BENCH_BATCH_SIZE) {
+            uint32_t batch_len = range->end - i;
+            if (batch_len > BENCH_BATCH_SIZE)
+                batch_len = BENCH_BATCH_SIZE;
+            for (uint32_t j = 0; j < batch_len; j++) {
+                batch[j].data = range->pkts[i + j].data;
+                batch[j].len = range->pkts[i + j].len;
+                batch[j].ifindex = 0;
+            }
+            for (uint32_t j = 0; j < batch_len; j++)
+                accepted += range->ebpf_filter(&batch[j]) != 0;
+        }
+    }
+    range->accepted = accepted;
+    return NULL;
+}
+
+int run_benchmark(packet_filter ebpf_filter, const char *prog_name, const char *pcap_name,
+                  int num_threads, int iterations, int debug) {
+    pcap_buffer_t *buffer = map_pkts_from_pcap(pcap_name);
+    if (buffer == NULL)
+        return EXIT_FAILURE;
+    if (buffer->len == 0) {
+        fprintf(stderr, "Error: %s does not contain any packets\n", pcap_name);
+        unmap_pcap_buffer(buffer);
+        return EXIT_FAILURE;
+    }
+    if ((uint32_t)num_threads > buffer->len)
+        num_threads = buffer->len;
+
+    /* Split the packets into disjoint ranges of (almost) equal size */
+    bench_range_t ranges[num_threads];
+    pthread_t threads[num_threads];
+    uint32_t chunk = buffer->len / num_threads;
+    uint32_t rest = buffer->len % num_threads;
+    uint32_t start = 0;
+    for (int t = 0; t < num_threads; t++) {
+        ranges[t].ebpf_filter = ebpf_filter;
+        ranges[t].pkts = buffer->pkts;
+        ranges[t].cpu = t;
+        ranges[t].start = start;
+        start += chunk + ((uint32_t)t < rest);
+        ranges[t].end = start;
+        ranges[t].iterations = iterations;
+        ranges[t].accepted = 0;
+        if (debug)
+            printf("Thread %d processes packets [%u, %u)\n", t, ranges[t].start, ranges[t].end);
+    }
+
+    uint64_t begin = now_ns();
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, feed_packet_range, &ranges[t]) != 0) {
+            perror("Fatal: Could not create thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    feed_packet_range(&ranges[0]);
+    for (int t = 1; t < num_threads; t++)
+        pthread_join(threads[t], NULL);
+    uint64_t elapsed = now_ns() - begin;
+
+    uint64_t total = (uint64_t)buffer->len * iterations;
+    uint64_t accepted = 0;
+    for (int t = 0; t < num_threads; t++)
+        accepted += ranges[t].accepted;
+    if (elapsed == 0)
+        elapsed = 1;
+    printf("%s: %llu packets (%llu accepted), %d thread(s), %.3f s, "
+           "%.0f packets/s, %.2f ns/packet\n",
+           prog_name, (unsigned long long)total, (unsigned long long)accepted,
+           num_threads, elapsed / 1e9, total * 1e9 / elapsed, (double)elapsed / total);
+    unmap_pcap_buffer(buffer);
+    return EXIT_SUCCESS;
+}
+
 void init_ebpf_tables(int debug) {
     /* Initialize the registry of shared tables */
     struct bpf_table* current = tables;
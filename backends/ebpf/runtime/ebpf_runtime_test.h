@@ -29,11 +29,15 @@ limitations under the License.
 typedef int (*packet_filter)(SK_BUFF* s);
 
 void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list, int debug);
+int run_benchmark(packet_filter ebpf_filter, const char *prog_name, const char *pcap_name, int num_threads, int iterations, int debug);
 void init_ebpf_tables(int debug);
 void delete_ebpf_tables(int debug);
 
 #define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug) \
     run_and_record_output(ebpf_filter, pcap_base, input_list, debug)
+#define BENCHMARK(ebpf_filter, prog_name, pcap_name, num_threads, iterations, debug) \
+    run_benchmark(ebpf_filter, prog_name, pcap_name, num_threads, iterations, debug)
+#define SET_NUM_CPUS(num_cpus) bpf_set_num_possible_cpus(num_cpus)
 #define INIT_EBPF_TABLES(debug) init_ebpf_tables(debug)
 #define DELETE_EBPF_TABLES(debug) delete_ebpf_tables(debug)
 
@@ -16,10 +16,20 @@ limitations under the License.
 
 #include <stdlib.h>     // EXIT_SUCCESS, EXIT_FAILURE
 #include <string.h>     // memcpy()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close()
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
 #include "pcap_util.h"
 
 #define DLT_EN10MB 1        // Ethernet Link Type, see also 'man pcap-linktype'
 
+/* Magic numbers of the pcap file format, see also 'man pcap-savefile' */
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_FILE_HDR_LEN 24
+#define PCAP_RECORD_HDR_LEN 16
+
 
 /* Dynamically-allocated list of packets.
  */
@@ -154,6 +164,98 @@ pcap_list_t *read_pkts_from_pcap(const char *pcap_file_name, iface_index index)
     return pkt_list;
 }
 
+static uint32_t read_u32(const unsigned char *buf, int swapped) {
+    uint32_t val;
+    memcpy(&val, buf, sizeof(val));
+    return swapped ? __builtin_bswap32(val) : val;
+}
+
+/* Visits every record and stores a reference to it if pkts is not Null.
+   Returns the number of records or -1 if the file is truncated. */
+static long index_pcap_records(unsigned char *map, size_t map_len,
+                               int swapped, pcap_pkt_ref *pkts) {
+    size_t offset = PCAP_FILE_HDR_LEN;
+    long count = 0;
+    while (offset < map_len) {
+        if (map_len - offset < PCAP_RECORD_HDR_LEN)
+            return -1;
+        /* The captured length is the third field of the record header */
+        uint32_t caplen = read_u32(map + offset + 8, swapped);
+        offset += PCAP_RECORD_HDR_LEN;
+        if (map_len - offset < caplen)
+            return -1;
+        if (pkts) {
+            pkts[count].data = map + offset;
+            pkts[count].len = caplen;
+        }
+        offset += caplen;
+        count++;
+    }
+    return count;
+}
+
+pcap_buffer_t *map_pkts_from_pcap(const char *pcap_file_name) {
+    int fd = open(pcap_file_name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open pcap file! %s \n", pcap_file_name);
+        perror("open");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < PCAP_FILE_HDR_LEN) {
+        fprintf(stderr, "Error: %s is not a pcap file\n", pcap_file_name);
+        close(fd);
+        return NULL;
+    }
+    /* Map privately so that programs can write to the packet data */
+    size_t map_len = st.st_size;
+    unsigned char *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    int swapped;
+    uint32_t magic = read_u32(map, 0);
+    if (magic == PCAP_MAGIC_USEC || magic == PCAP_MAGIC_NSEC) {
+        swapped = 0;
+    } else if (__builtin_bswap32(magic) == PCAP_MAGIC_USEC ||
+               __builtin_bswap32(magic) == PCAP_MAGIC_NSEC) {
+        swapped = 1;
+    } else {
+        fprintf(stderr, "Error: %s is not a pcap file\n", pcap_file_name);
+        munmap(map, map_len);
+        return NULL;
+    }
+    /* Count the packets first, so that the index is allocated only once */
+    long count = index_pcap_records(map, map_len, swapped, NULL);
+    if (count < 0 || count > UINT32_MAX) {
+        fprintf(stderr, "Error: %s is truncated or too large\n", pcap_file_name);
+        munmap(map, map_len);
+        return NULL;
+    }
+    pcap_buffer_t *buffer = calloc(1, sizeof(pcap_buffer_t));
+    pcap_pkt_ref *pkts = calloc(count ? count : 1, sizeof(pcap_pkt_ref));
+    if (!buffer || !pkts) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    index_pcap_records(map, map_len, swapped, pkts);
+    buffer->map = map;
+    buffer->map_len = map_len;
+    buffer->pkts = pkts;
+    buffer->len = count;
+    return buffer;
+}
+
+void unmap_pcap_buffer(pcap_buffer_t *buffer) {
+    if (!buffer)
+        return;
+    munmap(buffer->map, buffer->map_len);
+    free(buffer->pkts);
+    free(buffer);
+}
+
 int write_pkts_to_pcap(const char *pcap_file_name, const pcap_list_t *list) {
     pcap_t *in_handle;
     pcap_dumper_t *out_handle;
@@ -39,6 +39,22 @@ typedef struct {
     iface_index ifindex;
 } pcap_pkt;
 
+/* A reference to a packet stored in a memory-mapped pcap file. */
+typedef struct {
+    unsigned char *data;
+    uint32_t len;
+} pcap_pkt_ref;
+
+/* All packets of a pcap file mapped into memory.
+   The packet data is never copied, the references point into the mapping.
+ */
+typedef struct {
+    void *map;
+    size_t map_len;
+    pcap_pkt_ref *pkts;
+    uint32_t len;
+} pcap_buffer_t;
+
 struct pcap_list;
 struct pcap_list_array;
 typedef struct pcap_list pcap_list_t;
@@ -61,6 +77,29 @@ typedef struct pcap_list_array pcap_list_array_t;
  */
 pcap_list_t *read_pkts_from_pcap(const char *pcap_file_name, iface_index index);
 
+/**
+ * @brief Map all packets of a pcap file into memory.
+ * @details Memory-maps the given pcap file privately and indexes the
+ * packets it contains. Packets are not copied; writes to the packet data
+ * are not propagated to the file. Only the packet data up to the captured
+ * length is referenced. A buffer mapped by this function should
+ * subsequently be freed by unmap_pcap_buffer().
+ *
+ * @param pcap_file_name The exact name of the pcap file.
+ *
+ * @return A handle to the mapped buffer. Null if the file cannot be
+ * mapped or is not a valid pcap file.
+ */
+pcap_buffer_t *map_pkts_from_pcap(const char *pcap_file_name);
+
+/**
+ * @brief Unmaps a pcap buffer.
+ * @details Unmaps the file and deletes the packet references.
+ *
+ * @param buffer The buffer to delete.
+ */
+void unmap_pcap_buffer(pcap_buffer_t *buffer);
+
 /**
  * @brief Write a list of packets to a pcap file.
  * @details Iteratively dumps the packets to the given filename.
@@ -15,6 +15,10 @@ P4C=p4c-ebpf
 TARGET=test
 # Extra arguments for the compiler
 P4ARGS=
+# Arguments for the benchmark mode of the runtime (make bench)
+BENCH_PCAP=
+BENCH_THREADS=1
+BENCH_ITERATIONS=1
 
 # Argument for the GCC compiler
 GCC ?= gcc
@@ -23,7 +27,7 @@ BUILDDIR:= $(BPFDIR)build
 override INCLUDES+= -I./$(SRCDIR) -include ebpf_runtime_$(TARGET).h
 # Optimization flags to save space
 override CFLAGS+=-O2 -g # -Wall -Werror
-LIBS+=-lpcap
+LIBS+=-lpcap -lpthread
 SOURCES=$(SRCDIR)/ebpf_registry.c  $(SRCDIR)/ebpf_map.c $(BPFNAME).c
 SRC_BASE+=$(SRCDIR)/ebpf_runtime.c $(SRCDIR)/pcap_util.c $(SOURCES)
 SRC_BASE+=$(SRCDIR)/ebpf_runtime_$(TARGET).c
@@ -59,6 +63,15 @@ $(BPFNAME).c: $(P4FILE)
 	fi;
 	$(P4C) --Werror $(P4INCLUDE) --target $(TARGET) -o $@ $< $(P4ARGS)
 
+# Run the filter over all packets of BENCH_PCAP and report its throughput
+.PHONY: bench
+bench: all
+	@if [ -z "$(BENCH_PCAP)" ]; then \
+		echo "*** ERROR: BENCH_PCAP is not set"; \
+		exit 1;\
+	fi;
+	$(abspath $(BPFNAME)) -b -f $(BENCH_PCAP) -t $(BENCH_THREADS) -i $(BENCH_ITERATIONS)
+
 .PHONY: clean
 clean:
 	@echo "Deleting build folder"
@@ -52,8 +52,14 @@ def _generate_control_actions(cmds):
             tbl_name = cmd.table
             for key_num, key_field in enumerate(cmd.match):
                 field = key_field[0].split('.')[1]
-                generated += ("%s.%s = %s;\n\t"
-                              % (key_name, field, key_field[1]))
+                if isinstance(key_field[1], tuple):
+                    # value/prefix of the LPM field of an LPM trie key
+                    generated += ("LPM_KEY_SET(%s, %s, %s, %s);\n\t"
+                                  % (key_name, field, key_field[1][0],
+                                     key_field[1][1]))
+                else:
+                    generated += ("%s.%s = %s;\n\t"
+                                  % (key_name, field, key_field[1]))
         generated += ("tableFileDescriptor = "
                       "BPF_OBJ_GET(MAP_PATH \"/%s\");\n\t" %
                       tbl_name)
@@ -76,11 +82,36 @@ def _generate_control_actions(cmds):
     return generated
 
 
-def create_table_file(actions, tmpdir, file_name):
+def _generate_counter_checks(counters):
+    """ Generates the checks of the "check_counter" commands.
+    eBPF counters hold a single value, so the count type (packets or
+    bytes) is ignored. Counters are read as the sum of their values on
+    all CPUs; a counter without an entry is 0. """
+    generated = ""
+    for index, (name, counter_index, check) in enumerate(counters):
+        key_name = "key_%s%d" % (name, index)
+        generated += ("tableFileDescriptor = "
+                      "BPF_OBJ_GET(MAP_PATH \"/%s\");\n\t" % name)
+        generated += ("if (tableFileDescriptor < 0) {"
+                      "fprintf(stderr, \"map %s not loaded\");"
+                      " exit(1); }\n\t" % name)
+        generated += "%s_key %s = %s;\n\t" % (name, key_name, counter_index)
+        generated += ("if (BPF_USER_MAP_READ_COUNTER"
+                      "(tableFileDescriptor, &%s, &count) != 0)\n\t\t"
+                      "count = 0;\n\t" % key_name)
+        generated += ("if (!(count %s %s)) {\n\t\t" % (check[1], check[2]))
+        generated += ("fprintf(stderr, \"Counter %s(%s) is %%llu, "
+                      "expected %s %s\\n\", count);\n\t\t"
+                      % (name, counter_index, check[1], check[2]))
+        generated += "ok = EXIT_FAILURE;\n\t}\n\t"
+    return generated
+
+
+def create_table_file(actions, tmpdir, file_name, counters=[]):
     """ Create the control plane file.
     The control commands are provided by the stf parser.
     This generated file is required by ebpf_runtime.c to initialize
-    the control plane. """
+    the control plane and to check the counters after the run. """
     err = ""
     try:
         with open(tmpdir + "/" + file_name, "w+") as control_file:
@@ -91,6 +122,14 @@ def create_table_file(actions, tmpdir, file_name):
             control_file.write("int tableFileDescriptor;\n\t")
             generated_cmds = _generate_control_actions(actions)
             control_file.write(generated_cmds)
+            control_file.write("}\n\n")
+            control_file.write("static inline int check_counters() {")
+            control_file.write("\n\t")
+            control_file.write("int ok = EXIT_SUCCESS;\n\t")
+            control_file.write("int tableFileDescriptor;\n\t")
+            control_file.write("unsigned long long count;\n\t")
+            control_file.write(_generate_counter_checks(counters))
+            control_file.write("return ok;\n")
             control_file.write("}\n")
     except OSError as e:
         err = e
@@ -107,6 +146,7 @@ def parse_stf_file(raw_stf):
     input_pkts = {}
     cmds = []
     expected = {}
+    counters = []
     for stf_entry in stf_map:
         if stf_entry[0] == "packet":
             input_pkts.setdefault(stf_entry[1], []).append(
@@ -131,4 +171,6 @@ def parse_stf_file(raw_stf):
             cmd = eBPFCommand(
                 a_type=stf_entry[0], table=stf_entry[1], action=stf_entry[2])
             cmds.append(cmd)
-    return input_pkts, cmds, expected
+        elif stf_entry[0] == "check_counter":
+            counters.append((stf_entry[1], stf_entry[2], stf_entry[3]))
+    return input_pkts, cmds, expected, counters
@@ -138,11 +138,12 @@ class EBPFTarget(object):
             dictionary.
             After parsing the necessary information, it creates a control
             header for the runtime, which contains the extracted control
-             plane commands """
+             plane commands and counter checks """
         with open(stffile) as raw_stf:
-            input_pkts, cmds, self.expected = parse_stf_file(
+            input_pkts, cmds, self.expected, counters = parse_stf_file(
                 raw_stf)
-            result, err = create_table_file(cmds, self.tmpdir, "control.h")
+            result, err = create_table_file(cmds, self.tmpdir, "control.h",
+                                            counters)
             if result != SUCCESS:
                 return result
             result = self._write_pcap_files(input_pkts)
@@ -27,3 +27,6 @@
 
 /* Define to 1 if you have the cxxabi.h header */
 #cmakedefine HAVE_CXXABI_H 1
+
+/* Define to 1 to trace the creation and visits of IR nodes in -T logs */
+#cmakedefine IR_TRACING 1
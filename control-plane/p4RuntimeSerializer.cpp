@@ -15,8 +15,11 @@ limitations under the License.
 */
 
 #include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <set>
+#include <sstream>
 #include <typeinfo>
 #include <unordered_map>
 #include <utility>
@@ -87,6 +90,41 @@ static bool isControllerHeader(const IR::Type_Header* type) {
     return type->getAnnotation("controller_header") != nullptr;
 }
 
+/// Calls @function for every object with a preamble, i.e. with an id, in the
+/// P4Info @message, with the path of the P4Info fields which holds the object
+/// (e.g. "tables" or "externs.instances"), the object and its preamble.
+template <typename Func>
+static void forAllP4InfoObjects(const google::protobuf::Message& message, Func function,
+                                const std::string& path = "") {
+    using google::protobuf::FieldDescriptor;
+    using google::protobuf::Message;
+
+    auto descriptor = message.GetDescriptor();
+    auto reflection = message.GetReflection();
+    for (int i = 0; i < descriptor->field_count(); i++) {
+        auto field = descriptor->field(i);
+        if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE || field->is_map())
+            continue;
+        auto fieldPath = path.empty() ? field->name() : path + "." + field->name();
+        auto visitObject = [&](const Message& object) {
+            auto preamble = object.GetDescriptor()->FindFieldByName("preamble");
+            if (preamble == nullptr) {
+                forAllP4InfoObjects(object, function, fieldPath);
+                return;
+            }
+            auto& protoPreamble = static_cast<const p4configv1::Preamble&>(
+                object.GetReflection()->GetMessage(object, preamble));
+            function(fieldPath, object, protoPreamble);
+        };
+        if (field->is_repeated()) {
+            for (int j = 0; j < reflection->FieldSize(message, field); j++)
+                visitObject(reflection->GetRepeatedMessage(message, field, j));
+        } else if (reflection->HasField(message, field)) {
+            visitObject(reflection->GetMessage(message, field));
+        }
+    }
+}
+
 /// @return the value of @item's explicit name annotation, if it has one. We use
 /// this rather than e.g. controlPlaneName() when we want to prevent any
 /// fallback.
@@ -171,6 +209,137 @@ static bool writeTextTo(const Message& message, std::ostream* destination) {
 
 }  // namespace writers
 
+/// Writes static table entries to files as they are generated. Each file
+/// holds a single WriteRequest message in the format of the file, but at
+/// most @ref chunkSize updates per file are held in memory at any time.
+/// The binary and text formats of a WriteRequest with only updates are the
+/// concatenation of the formats of its chunks, and the JSON format is
+/// written one update at a time. If @perTable is set, the entries of each
+/// table are written to their own files, named by inserting the table name
+/// before the suffix of each file name.
+class EntriesFileWriter final : public P4RuntimeEntriesSink {
+ public:
+    static const int chunkSize = 1024;
+
+    EntriesFileWriter(const std::vector<cstring>& files,
+                      const std::vector<P4RuntimeFormat>& formats, bool perTable)
+        : files(files), formats(formats), perTable(perTable) {
+        BUG_CHECK(files.size() == formats.size(), "Mismatched files and formats");
+        if (!perTable)
+            open(cstring());
+    }
+
+    void add(cstring tableName, const p4v1::Update& update) override {
+        if (perTable && tableName != currentTable) {
+            close();
+            BUG_CHECK(writtenTables.count(tableName) == 0,
+                      "Entries of table %1% are not contiguous", tableName);
+            writtenTables.insert(tableName);
+            currentTable = tableName;
+            open(tableName);
+        }
+        for (auto output : outputs) {
+            *output->chunk.add_updates() = update;
+            if (output->chunk.updates_size() >= chunkSize)
+                flush(output);
+        }
+    }
+
+    /// Writes the remaining entries and closes all the files.
+    void close() {
+        for (auto output : outputs) {
+            flush(output);
+            if (output->format == P4RuntimeFormat::JSON)
+                *output->stream << (output->written == 0 ? "{\n}\n" : "\n ]\n}\n");
+            output->stream->flush();
+            if (!output->stream->good())
+                ::error("Failed to write P4Runtime static table entries to %1%", output->file);
+            delete output->stream;
+            delete output;
+        }
+        outputs.clear();
+    }
+
+ private:
+    struct Output {
+        cstring file;
+        std::ostream* stream;
+        P4RuntimeFormat format;
+        p4v1::WriteRequest chunk;  // updates not written yet
+        int written = 0;           // number of updates written so far
+    };
+
+    static cstring shardFileName(cstring file, cstring tableName) {
+        std::string name(file.c_str());
+        auto dot = name.rfind('.');
+        auto slash = name.rfind('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return name + "." + tableName;
+        return name.substr(0, dot) + "." + tableName + name.substr(dot);
+    }
+
+    void open(cstring tableName) {
+        for (size_t i = 0; i < files.size(); i++) {
+            cstring file = perTable ? shardFileName(files.at(i), tableName) : files.at(i);
+            std::ostream* stream = openFile(file, false);
+            if (!stream) {
+                ::error("Couldn't open P4Runtime static entries file: %1%", file);
+                continue;
+            }
+            auto output = new Output;
+            output->file = file;
+            output->stream = stream;
+            output->format = formats.at(i);
+            outputs.push_back(output);
+        }
+    }
+
+    void flush(Output* output) {
+        using namespace google::protobuf::util;
+
+        if (output->chunk.updates_size() == 0)
+            return;
+        bool success = true;
+        switch (output->format) {
+            case P4RuntimeFormat::BINARY:
+                success = writers::writeTo(output->chunk, output->stream);
+                break;
+            case P4RuntimeFormat::TEXT:
+                success = writers::writeTextTo(output->chunk, output->stream);
+                break;
+            case P4RuntimeFormat::JSON: {
+                JsonPrintOptions options;
+                options.add_whitespace = true;
+                int index = output->written;
+                for (const auto& update : output->chunk.updates()) {
+                    std::string json;
+                    if (MessageToJsonString(update, &json, options) != Status::OK) {
+                        success = false;
+                        break;
+                    }
+                    if (!json.empty() && json.back() == '\n')
+                        json.pop_back();
+                    *output->stream << (index++ == 0 ? "{\n \"updates\": [\n" : ",\n") << json;
+                }
+                break;
+            }
+        }
+        if (!success)
+            ::error("Failed to serialize the P4Runtime static table entries to %1%",
+                    output->file);
+        output->written += output->chunk.updates_size();
+        output->chunk.Clear();
+    }
+
+    const std::vector<cstring> files;
+    const std::vector<P4RuntimeFormat> formats;
+    const bool perTable;
+    /// Table whose entries are being written, if writing per table.
+    cstring currentTable;
+    std::set<cstring> writtenTables;
+    std::vector<Output*> outputs;
+};
+
 /// The information about a default action which is needed to serialize it.
 struct DefaultAction {
     const cstring name;  // The fully qualified external name of this action.
@@ -352,13 +521,19 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
      * to a non-const reference to the symbol table.
      */
     template <typename Func>
-    static const P4RuntimeSymbolTable create(Func function) {
+    static const P4RuntimeSymbolTable create(Func function,
+                                             const p4configv1::P4Info* previousP4Info = nullptr) {
         // Create and initialize the symbol table. At this stage, ids aren't
         // available, because computing ids requires global knowledge of all the
         // P4Runtime symbols in the program.
         P4RuntimeSymbolTable symbols;
         function(symbols);
 
+        // Symbols which were in the previous P4Info keep their id, unless an
+        // '@id' annotation now uses it.
+        if (previousP4Info != nullptr)
+            symbols.reuseIds(*previousP4Info);
+
         // Now that the symbol table is initialized, we can compute ids.
         for (auto& table : symbols.symbolTables)
             symbols.computeIdsForSymbols(table.first);
@@ -434,6 +609,42 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
         return *id;
     }
 
+    /**
+     * Assign to each symbol without an id the id of the object with the same
+     * type and name in @previous. The ids of objects which no longer exist
+     * are not assigned to new symbols either, so that the control plane
+     * never sees an id change meaning.
+     */
+    void reuseIds(const p4configv1::P4Info& previous) {
+        std::map<p4rt_id_t, SymbolTable> previousIds;
+        forAllP4InfoObjects(previous, [&](const std::string&, const google::protobuf::Message&,
+                                          const p4configv1::Preamble& preamble) {
+            previousIds[preamble.id() >> 24].emplace(preamble.name(), preamble.id());
+        });
+
+        for (auto& table : symbolTables) {
+            auto resourceType = static_cast<p4rt_id_t>(table.first);
+            auto previousTable = previousIds.find(resourceType);
+            if (previousTable == previousIds.end())
+                continue;
+            for (auto& symbol : table.second) {
+                if (symbol.second != INVALID_ID)
+                    continue;
+                auto previousId = previousTable->second.find(symbol.first);
+                if (previousId == previousTable->second.end() ||
+                    assignedIds.count(previousId->second) != 0)
+                    continue;
+                symbol.second = previousId->second;
+                assignedIds.insert(previousId->second);
+            }
+        }
+
+        for (auto& table : previousIds) {
+            for (auto& symbol : table.second)
+                assignedIds.insert(symbol.second);
+        }
+    }
+
     /**
      * Assign an id to each resource of @type (ACTION, TABLE, etc..)  which does
      * not yet have an id, and update the resource in place.  Existing ids are
@@ -844,6 +1055,10 @@ class P4RuntimeAnalyzer {
      * handles architecture-specific constructs (e.g. externs).
      * @param arch  The name of the P4_16 architecture the program was written
      * against.
+     * @param entriesSink  If not null, receives the static table entries,
+     * which are then not part of the returned API.
+     * @param previousP4Info  If not null, the P4Info of a previous version of
+     * the program, whose ids are kept for the objects which still exist.
      * @return a P4Info message representing the program's control plane API.
      *         Never returns null.
      */
@@ -852,7 +1067,9 @@ class P4RuntimeAnalyzer {
                                 ReferenceMap* refMap,
                                 TypeMap* typeMap,
                                 P4RuntimeArchHandlerIface* archHandler,
-                                cstring arch);
+                                cstring arch,
+                                P4RuntimeEntriesSink* entriesSink,
+                                const p4configv1::P4Info* previousP4Info);
 
     void addAction(const IR::P4Action* actionDeclaration) {
         if (isHidden(actionDeclaration)) return;
@@ -1330,8 +1547,8 @@ class P4RuntimeEntriesConverter {
  private:
     friend class P4RuntimeAnalyzer;
 
-    P4RuntimeEntriesConverter(const P4RuntimeSymbolTable& symbols)
-        : entries(new p4v1::WriteRequest), symbols(symbols) { }
+    P4RuntimeEntriesConverter(const P4RuntimeSymbolTable& symbols, P4RuntimeEntriesSink* sink)
+        : entries(new p4v1::WriteRequest), sink(sink), symbols(symbols) { }
 
     /// @return the P4Runtime WriteRequest message generated by this analyzer.
     const p4v1::WriteRequest* getEntries() const {
@@ -1339,7 +1556,8 @@ class P4RuntimeEntriesConverter {
         return entries;
     }
 
-    /// Appends the 'const entries' for the table to the WriteRequest message.
+    /// Appends the 'const entries' for the table to the WriteRequest message,
+    /// or passes them one at a time to the sink if there is one.
     void addTableEntries(const IR::TableBlock* tableBlock, ReferenceMap* refMap,
                          TypeMap* typeMap, P4RuntimeArchHandlerIface* archHandler) {
         CHECK_NULL(tableBlock);
@@ -1353,8 +1571,15 @@ class P4RuntimeEntriesConverter {
 
         int entryPriority = entriesList->entries.size();
         auto needsPriority = tableNeedsPriority(table, refMap);
+        // Reused for every entry given to the sink, so memory use does not
+        // depend on the number of entries.
+        p4v1::Update streamedUpdate;
         for (auto e : entriesList->entries) {
-            auto protoUpdate = entries->add_updates();
+            auto protoUpdate = &streamedUpdate;
+            if (sink == nullptr)
+                protoUpdate = entries->add_updates();
+            else
+                protoUpdate->Clear();
             protoUpdate->set_type(p4v1::Update::INSERT);
             auto protoEntity = protoUpdate->mutable_entity();
             auto protoEntry = protoEntity->mutable_table_entry();
@@ -1376,6 +1601,8 @@ class P4RuntimeEntriesConverter {
                           "The @priority annotation on %1% is not part of the P4 specification, "
                           "nor of the P4Runtime specification, and will be ignored", e);
             }
+            if (sink != nullptr)
+                sink->add(tableName, *protoUpdate);
         }
     }
 
@@ -1678,6 +1905,8 @@ class P4RuntimeEntriesConverter {
 
     /// We represent all static table entries as one P4Runtime WriteRequest object
     p4v1::WriteRequest *entries;
+    /// If not null, receives the entries instead of 'entries'.
+    P4RuntimeEntriesSink* sink;
     /// The symbols used in the API and their ids.
     const P4RuntimeSymbolTable& symbols;
 };
@@ -1688,7 +1917,9 @@ P4RuntimeAnalyzer::analyze(const IR::P4Program* program,
                            ReferenceMap* refMap,
                            TypeMap* typeMap,
                            P4RuntimeArchHandlerIface* archHandler,
-                           cstring arch) {
+                           cstring arch,
+                           P4RuntimeEntriesSink* entriesSink,
+                           const p4configv1::P4Info* previousP4Info) {
     using namespace ControlPlaneAPI;
 
     CHECK_NULL(archHandler);
@@ -1713,7 +1944,7 @@ P4RuntimeAnalyzer::analyze(const IR::P4Program* program,
             }
         });
         archHandler->collectExtra(&symbols);
-    });
+    }, previousP4Info);
 
     archHandler->postCollect(symbols);
 
@@ -1750,7 +1981,7 @@ P4RuntimeAnalyzer::analyze(const IR::P4Program* program,
 
     analyzer.addPkgInfo(evaluatedProgram, arch);
 
-    P4RuntimeEntriesConverter entriesConverter(symbols);
+    P4RuntimeEntriesConverter entriesConverter(symbols, entriesSink);
     Helpers::forAllEvaluatedBlocks(evaluatedProgram, [&](const IR::Block* block) {
         if (block->is<IR::TableBlock>())
             entriesConverter.addTableEntries(block->to<IR::TableBlock>(), refMap,
@@ -1765,7 +1996,9 @@ P4RuntimeAnalyzer::analyze(const IR::P4Program* program,
 }  // namespace ControlPlaneAPI
 
 P4RuntimeAPI
-P4RuntimeSerializer::generateP4Runtime(const IR::P4Program* program, cstring arch) {
+P4RuntimeSerializer::generateP4Runtime(const IR::P4Program* program, cstring arch,
+                                       P4RuntimeEntriesSink* entriesSink,
+                                       const ::p4::config::v1::P4Info* previousP4Info) {
     using namespace ControlPlaneAPI;
 
     auto archHandlerBuilderIt = archHandlerBuilders.find(arch);
@@ -1802,7 +2035,8 @@ P4RuntimeSerializer::generateP4Runtime(const IR::P4Program* program, cstring arc
     auto archHandler = (*archHandlerBuilderIt->second)(&refMap, &typeMap, evaluatedProgram);
 
     return P4RuntimeAnalyzer::analyze(p4RuntimeProgram, evaluatedProgram,
-                                      &refMap, &typeMap, archHandler, arch);
+                                      &refMap, &typeMap, archHandler, arch, entriesSink,
+                                      previousP4Info);
 }
 
 void P4RuntimeAPI::serializeP4InfoTo(std::ostream* destination, P4RuntimeFormat format) const {
@@ -1879,29 +2113,110 @@ static bool parseFileNames(cstring fileNameVector,
     return true;
 }
 
-void
-P4RuntimeSerializer::serializeP4RuntimeIfRequired(const IR::P4Program* program,
-                                                  const CompilerOptions& options) {
+/// @return the P4Info message in @file, in the format given by its suffix,
+/// or nullptr if it cannot be read.
+static const p4configv1::P4Info* readP4Info(cstring file) {
+    using namespace google::protobuf::util;
+
     std::vector<cstring> files;
     std::vector<P4::P4RuntimeFormat> formats;
+    if (!parseFileNames(file, files, formats))
+        return nullptr;
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if (!in.good()) {
+        ::error("Couldn't open P4Info file: %1%", file);
+        return nullptr;
+    }
 
-    // only generate P4Info is required by use-provided options
-    if (options.p4RuntimeFile.isNullOrEmpty() &&
-        options.p4RuntimeFiles.isNullOrEmpty() &&
-        options.p4RuntimeEntriesFile.isNullOrEmpty() &&
-        options.p4RuntimeEntriesFiles.isNullOrEmpty()) {
-        return;
+    auto p4Info = new p4configv1::P4Info;
+    bool success = true;
+    std::stringstream contents;
+    switch (formats.at(0)) {
+        case P4::P4RuntimeFormat::BINARY:
+            success = p4Info->ParseFromIstream(&in);
+            break;
+        case P4::P4RuntimeFormat::JSON:
+            contents << in.rdbuf();
+            success = JsonStringToMessage(contents.str(), p4Info) == Status::OK;
+            break;
+        case P4::P4RuntimeFormat::TEXT:
+            contents << in.rdbuf();
+            success = google::protobuf::TextFormat::ParseFromString(contents.str(), p4Info);
+            break;
     }
-    auto arch = P4RuntimeSerializer::resolveArch(options);
-    if (Log::verbose())
-        std::cout << "Generating P4Runtime output for architecture " << arch << std::endl;
-    auto p4Runtime = get()->generateP4Runtime(program, arch);
-    serializeP4RuntimeIfRequired(p4Runtime, options);
+    if (!success) {
+        ::error("Failed to parse P4Info file: %1%", file);
+        return nullptr;
+    }
+    return p4Info;
 }
 
-void
-P4RuntimeSerializer::serializeP4RuntimeIfRequired(const P4RuntimeAPI& p4Runtime,
-                                                  const CompilerOptions& options) {
+/// Writes to @destination a line for each object with an id which was added
+/// ('+'), removed ('-') or changed ('~') from @previous to @current, giving
+/// the P4Info field which holds it, its name and its id.
+static void writeP4InfoDiff(const p4configv1::P4Info& previous,
+                            const p4configv1::P4Info& current, std::ostream* destination) {
+    using google::protobuf::Message;
+    using google::protobuf::util::MessageDifferencer;
+
+    // Objects indexed by P4Info field and name.
+    using Key = std::pair<std::string, std::string>;
+    using Objects = std::map<Key, std::pair<const Message*, uint32_t>>;
+    auto collect = [](const p4configv1::P4Info& p4Info) {
+        Objects objects;
+        ControlPlaneAPI::forAllP4InfoObjects(p4Info,
+            [&](const std::string& path, const Message& object,
+                const p4configv1::Preamble& preamble) {
+                objects.emplace(Key(path, preamble.name()),
+                                std::make_pair(&object, preamble.id()));
+            });
+        return objects;
+    };
+    auto previousObjects = collect(previous);
+    auto currentObjects = collect(current);
+
+    std::set<Key> keys;
+    for (auto& object : previousObjects) keys.insert(object.first);
+    for (auto& object : currentObjects) keys.insert(object.first);
+    for (auto& key : keys) {
+        auto before = previousObjects.find(key);
+        auto after = currentObjects.find(key);
+        if (before == previousObjects.end()) {
+            *destination << "+ " << key.first << " " << key.second << " "
+                         << after->second.second << std::endl;
+        } else if (after == currentObjects.end()) {
+            *destination << "- " << key.first << " " << key.second << " "
+                         << before->second.second << std::endl;
+        } else if (!MessageDifferencer::Equals(*before->second.first, *after->second.first)) {
+            *destination << "~ " << key.first << " " << key.second << " "
+                         << before->second.second;
+            if (before->second.second != after->second.second)
+                *destination << " -> " << after->second.second;
+            *destination << std::endl;
+        }
+    }
+    if (!destination->good())
+        ::error("Failed to write the P4Info changes to the output");
+}
+
+/// @return a writer for the static table entries files requested by the
+/// command-line @options, or nullptr if there are none.
+static ControlPlaneAPI::EntriesFileWriter*
+createEntriesWriter(const CompilerOptions& options) {
+    std::vector<cstring> files;
+    std::vector<P4::P4RuntimeFormat> formats;
+    if (!options.p4RuntimeEntriesFile.isNullOrEmpty()) {
+        files.push_back(options.p4RuntimeEntriesFile);
+        formats.push_back(options.p4RuntimeFormat);
+    }
+    if (!parseFileNames(options.p4RuntimeEntriesFiles, files, formats) || files.empty())
+        return nullptr;
+    return new ControlPlaneAPI::EntriesFileWriter(files, formats,
+                                                  options.p4RuntimeEntriesPerTable);
+}
+
+static void serializeP4InfoIfRequired(const P4RuntimeAPI& p4Runtime,
+                                      const CompilerOptions& options) {
     std::vector<cstring> files;
     std::vector<P4::P4RuntimeFormat> formats;
 
@@ -1912,44 +2227,80 @@ P4RuntimeSerializer::serializeP4RuntimeIfRequired(const P4RuntimeAPI& p4Runtime,
     if (!parseFileNames(options.p4RuntimeFiles, files, formats))
         return;
 
-    if (!files.empty()) {
-        for (unsigned i = 0; i < files.size(); i++) {
-            cstring file = files.at(i);
-            P4::P4RuntimeFormat format = formats.at(i);
-            std::ostream* out = openFile(file, false);
-            if (!out) {
-                ::error("Couldn't open P4Runtime API file: %1%", file);
-                continue;
-            }
-            p4Runtime.serializeP4InfoTo(out, format);
+    for (unsigned i = 0; i < files.size(); i++) {
+        cstring file = files.at(i);
+        P4::P4RuntimeFormat format = formats.at(i);
+        std::ostream* out = openFile(file, false);
+        if (!out) {
+            ::error("Couldn't open P4Runtime API file: %1%", file);
+            continue;
         }
+        p4Runtime.serializeP4InfoTo(out, format);
     }
+}
 
-    // Do the same for the entries files
-    files.clear();
-    formats.clear();
-    if (!options.p4RuntimeEntriesFile.isNullOrEmpty()) {
-        files.push_back(options.p4RuntimeEntriesFile);
-        formats.push_back(options.p4RuntimeFormat);
+void
+P4RuntimeSerializer::serializeP4RuntimeIfRequired(const IR::P4Program* program,
+                                                  const CompilerOptions& options) {
+    // only generate P4Info is required by use-provided options
+    if (options.p4RuntimeFile.isNullOrEmpty() &&
+        options.p4RuntimeFiles.isNullOrEmpty() &&
+        options.p4RuntimeEntriesFile.isNullOrEmpty() &&
+        options.p4RuntimeEntriesFiles.isNullOrEmpty() &&
+        options.p4RuntimeP4InfoDiffFile.isNullOrEmpty()) {
+        return;
     }
-
-    if (!parseFileNames(options.p4RuntimeEntriesFiles, files, formats))
+    const p4configv1::P4Info* previousP4Info = nullptr;
+    if (!options.p4RuntimePreviousP4Info.isNullOrEmpty()) {
+        previousP4Info = readP4Info(options.p4RuntimePreviousP4Info);
+        if (previousP4Info == nullptr)
+            return;
+    } else if (!options.p4RuntimeP4InfoDiffFile.isNullOrEmpty()) {
+        ::error("'--p4runtime-p4info-diff' requires '--p4runtime-previous-p4info'");
         return;
-    if (!files.empty()) {
-        for (unsigned i = 0; i < files.size(); i++) {
-            cstring file = files.at(i);
-            P4::P4RuntimeFormat format = formats.at(i);
-            std::ostream* out = openFile(file, false);
-            if (!out) {
-                ::error("Couldn't open P4Runtime static entries file: %1%",
-                        options.p4RuntimeEntriesFile);
-                continue;
-            }
-            p4Runtime.serializeEntriesTo(out, format);
+    }
+
+    auto arch = P4RuntimeSerializer::resolveArch(options);
+    if (Log::verbose())
+        std::cout << "Generating P4Runtime output for architecture " << arch << std::endl;
+    // The entries are written as they are generated instead of being
+    // collected in the P4RuntimeAPI.
+    auto entriesWriter = createEntriesWriter(options);
+    auto p4Runtime = get()->generateP4Runtime(program, arch, entriesWriter, previousP4Info);
+    serializeP4InfoIfRequired(p4Runtime, options);
+    if (entriesWriter != nullptr) {
+        entriesWriter->close();
+        delete entriesWriter;
+    }
+
+    if (!options.p4RuntimeP4InfoDiffFile.isNullOrEmpty()) {
+        std::ostream* out = openFile(options.p4RuntimeP4InfoDiffFile, false);
+        if (!out) {
+            ::error("Couldn't open P4Info changes file: %1%", options.p4RuntimeP4InfoDiffFile);
+            return;
         }
+        writeP4InfoDiff(*previousP4Info, *p4Runtime.p4Info, out);
+        out->flush();
     }
 }
 
+void
+P4RuntimeSerializer::serializeP4RuntimeIfRequired(const P4RuntimeAPI& p4Runtime,
+                                                  const CompilerOptions& options) {
+    serializeP4InfoIfRequired(p4Runtime, options);
+
+    auto entriesWriter = createEntriesWriter(options);
+    if (entriesWriter == nullptr)
+        return;
+    std::map<uint32_t, cstring> tableNames;
+    for (const auto& table : p4Runtime.p4Info->tables())
+        tableNames.emplace(table.preamble().id(), table.preamble().name());
+    for (const auto& update : p4Runtime.entries->updates())
+        entriesWriter->add(tableNames[update.entity().table_entry().table_id()], update);
+    entriesWriter->close();
+    delete entriesWriter;
+}
+
 P4RuntimeSerializer::P4RuntimeSerializer() {
     registerArch("v1model", new ControlPlaneAPI::Standard::V1ModelArchHandlerBuilder());
     registerArch("psa", new ControlPlaneAPI::Standard::PSAArchHandlerBuilder());
@@ -29,6 +29,7 @@ class P4Info;
 }  // namespace v1
 }  // namespace config
 namespace v1 {
+class Update;
 class WriteRequest;
 }  // namespace v1
 }  // namespace p4
@@ -48,6 +49,17 @@ enum class P4RuntimeFormat {
   TEXT
 };
 
+/// Receives the static table entries of a program one P4Runtime Update at a
+/// time, as they are generated, so that they never need to be held in memory
+/// all at once.
+class P4RuntimeEntriesSink {
+ public:
+    virtual ~P4RuntimeEntriesSink() { }
+    /// Called for each entry, with all the entries of a table in a row.
+    /// @update is only valid for the duration of the call.
+    virtual void add(cstring tableName, const ::p4::v1::Update& update) = 0;
+};
+
 /// A P4 program's control-plane API, represented in terms of P4Runtime's data
 /// structures. Can be inspected or serialized.
 struct P4RuntimeAPI {
@@ -88,9 +100,16 @@ class P4RuntimeSerializer {
      *
      * @param program  The program to construct the control-plane API from. All
      *                 frontend passes must have already run.
+     * @param entriesSink  If not null, receives the static table entries,
+     *                     which are then not included in the returned API.
+     * @param previousP4Info  If not null, the P4Info generated for a previous
+     *                        version of the program. Objects which still exist
+     *                        keep the same id.
      * @return the generated P4Runtime API.
      */
-    P4RuntimeAPI generateP4Runtime(const IR::P4Program* program, cstring arch);
+    P4RuntimeAPI generateP4Runtime(const IR::P4Program* program, cstring arch,
+                                   P4RuntimeEntriesSink* entriesSink = nullptr,
+                                   const ::p4::config::v1::P4Info* previousP4Info = nullptr);
 
     /**
      * A convenience wrapper for P4::generateP4Runtime() which generates the
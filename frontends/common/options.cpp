@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include <getopt.h>
+#include <cstdlib>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -27,6 +28,7 @@ limitations under the License.
 #include "lib/path.h"
 #include "frontends/p4/toP4/toP4.h"
 #include "ir/json_generator.h"
+#include "ir/mem_accounting.h"
 #include "frontends/p4/frontend.h"
 
 const char* p4includePath = CONFIG_PKGDATADIR "/p4include";
@@ -117,6 +119,19 @@ CompilerOptions::CompilerOptions() : Util::Options(defaultMessage) {
                    "Write static table entries as a P4Runtime WriteRequest message\n"
                    "to the specified files (comma-separated list); the file format is\n"
                    "inferred from the suffix. Legal suffixes are .json, .txt and .bin");
+    registerOption("--p4runtime-entries-per-table", nullptr,
+                   [this](const char*) { p4RuntimeEntriesPerTable = true; return true; },
+                   "Write the static table entries of each table to separate files, named\n"
+                   "by inserting the table name before the suffix of each entries file");
+    registerOption("--p4runtime-previous-p4info", "file",
+                   [this](const char* arg) { p4RuntimePreviousP4Info = arg; return true; },
+                   "Keep the P4Runtime ids of the objects in the specified P4Info file,\n"
+                   "generated for a previous version of the program, if they still exist.\n"
+                   "The format is inferred from the suffix: .txt, .json, .bin");
+    registerOption("--p4runtime-p4info-diff", "file",
+                   [this](const char* arg) { p4RuntimeP4InfoDiffFile = arg; return true; },
+                   "Write the P4Runtime objects added, removed or changed since the P4Info\n"
+                   "given with '--p4runtime-previous-p4info' to the specified file");
     registerOption("--p4runtime-format", "{binary,json,text}",
                    [this](const char* arg) {
                        if (!strcmp(arg, "binary")) {
@@ -193,6 +208,14 @@ CompilerOptions::CompilerOptions() : Util::Options(defaultMessage) {
     registerOption("-T", "loglevel",
                    [](const char* arg) { Log::addDebugSpec(arg); return true; },
                    "[Compiler debugging] Adjust logging level per file (see below)");
+    registerOption("--mem-report", nullptr,
+                   [](const char*) {
+                       if (!IR::MemoryAccounting::enabled) {
+                           IR::MemoryAccounting::enable();
+                           std::atexit([]() { IR::MemoryAccounting::report(std::cerr); }); }
+                       return true; },
+                   "[Compiler debugging] Report the memory allocated by IR node type\n"
+                   "and by pass when exiting");
     registerOption("-v", nullptr,
                    [](const char*) { Log::increaseVerbosity(); return true; },
                    "[Compiler debugging] Increase verbosity level (can be repeated)");
@@ -105,6 +105,15 @@ class CompilerOptions : public Util::Options {
     // Write static table entries as a P4Runtime WriteRequest message to the specified files.
     cstring p4RuntimeEntriesFiles = nullptr;
 
+    // Write the static table entries of each table to separate files.
+    bool p4RuntimeEntriesPerTable = false;
+
+    // Reuse the P4Runtime ids of the objects in this P4Info file.
+    cstring p4RuntimePreviousP4Info = nullptr;
+
+    // Write the changes since the previous P4Info to the specified file.
+    cstring p4RuntimeP4InfoDiffFile = nullptr;
+
     // Choose format for P4Runtime API description.
     P4::P4RuntimeFormat p4RuntimeFormat = P4::P4RuntimeFormat::BINARY;
 
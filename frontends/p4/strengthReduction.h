@@ -60,7 +60,11 @@ class DoStrengthReduction final : public Transform {
     const IR::Node* simplifyConcat(IR::Slice* expr);
 
  public:
-    DoStrengthReduction() { visitDagOnce = true; setName("StrengthReduction"); }
+    DoStrengthReduction() {
+        visitDagOnce = true;
+        deleteUnchangedClones = true;
+        setName("StrengthReduction");
+    }
 
     using Transform::postorder;
 
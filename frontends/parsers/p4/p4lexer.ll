@@ -18,6 +18,19 @@ using Parser = P4::P4Parser;
         P4::Token(Parser::token::TOK_ ## symbol, yytext), \
         driver.yylloc)
 
+// Keywords and operators always have the same text, so the cstring is
+// created once rather than looked up again for each occurrence.
+#define makeFixedToken(symbol) \
+    Parser::make_ ## symbol( \
+        P4::Token(Parser::token::TOK_ ## symbol, \
+                  fixedTokenText<Parser::token::TOK_ ## symbol>(yytext)), \
+        driver.yylloc)
+
+template<int token> static cstring fixedTokenText(const char* text) {
+    static const cstring result(text);
+    return result;
+}
+
 // Silence the warnings triggered by the code flex generates.
 #pragma GCC diagnostic ignored "-Wpragmas"
 #pragma GCC diagnostic ignored "-Wunused-function"
@@ -97,52 +110,52 @@ using Parser = P4::P4Parser;
 <STRING>\n      { driver.stringLiteral += yytext; }
 
 "@pragma"       { BEGIN((driver.saveState = PRAGMA_LINE));
-                  return makeToken(PRAGMA); }
-
-"abstract"      { BEGIN(driver.saveState); return makeToken(ABSTRACT); }
-"action"        { BEGIN(driver.saveState); return makeToken(ACTION); }
-"actions"       { BEGIN(driver.saveState); return makeToken(ACTIONS); }
-"apply"         { BEGIN(driver.saveState); return makeToken(APPLY); }
-"bool"          { BEGIN(driver.saveState); return makeToken(BOOL); }
-"bit"           { BEGIN(driver.saveState); return makeToken(BIT); }
-"const"         { BEGIN(driver.saveState); return makeToken(CONST); }
-"control"       { BEGIN(driver.saveState); return makeToken(CONTROL); }
-"default"       { BEGIN(driver.saveState); return makeToken(DEFAULT); }
-"else"          { BEGIN(driver.saveState); return makeToken(ELSE); }
-"entries"       { BEGIN(driver.saveState); return makeToken(ENTRIES); }
-"enum"          { BEGIN(driver.saveState); return makeToken(ENUM); }
-"error"         { BEGIN(driver.saveState); return makeToken(ERROR); }
-"exit"          { BEGIN(driver.saveState); return makeToken(EXIT); }
-"extern"        { BEGIN(driver.saveState); return makeToken(EXTERN); }
-"false"         { BEGIN(driver.saveState); return makeToken(FALSE); }
-"header"        { BEGIN(driver.saveState); return makeToken(HEADER); }
-"header_union"  { BEGIN(driver.saveState); return makeToken(HEADER_UNION); }
-"if"            { BEGIN(driver.saveState); return makeToken(IF); }
-"in"            { BEGIN(driver.saveState); return makeToken(IN); }
-"inout"         { BEGIN(driver.saveState); return makeToken(INOUT); }
-"int"           { BEGIN(driver.saveState); return makeToken(INT); }
-"key"           { BEGIN(driver.saveState); return makeToken(KEY); }
-"match_kind"    { BEGIN(driver.saveState); return makeToken(MATCH_KIND); }
-"type"          { BEGIN(driver.saveState); return makeToken(TYPE); }
-"out"           { BEGIN(driver.saveState); return makeToken(OUT); }
-"parser"        { BEGIN(driver.saveState); return makeToken(PARSER); }
-"package"       { BEGIN(driver.saveState); return makeToken(PACKAGE); }
-"return"        { BEGIN(driver.saveState); return makeToken(RETURN); }
-"select"        { BEGIN(driver.saveState); return makeToken(SELECT); }
-"state"         { BEGIN(driver.saveState); return makeToken(STATE); }
-"string"        { BEGIN(driver.saveState); return makeToken(STRING); }
-"struct"        { BEGIN(driver.saveState); return makeToken(STRUCT); }
-"switch"        { BEGIN(driver.saveState); return makeToken(SWITCH); }
-"table"         { BEGIN(driver.saveState); return makeToken(TABLE); }
-"this"          { BEGIN(driver.saveState); return makeToken(THIS); }
-"transition"    { BEGIN(driver.saveState); return makeToken(TRANSITION); }
-"true"          { BEGIN(driver.saveState); return makeToken(TRUE); }
-"tuple"         { BEGIN(driver.saveState); return makeToken(TUPLE); }
-"typedef"       { BEGIN(driver.saveState); return makeToken(TYPEDEF); }
-"varbit"        { BEGIN(driver.saveState); return makeToken(VARBIT); }
-"value_set"     { BEGIN(driver.saveState); return makeToken(VALUESET); }
-"void"          { BEGIN(driver.saveState); return makeToken(VOID); }
-"_"             { BEGIN(driver.saveState); return makeToken(DONTCARE); }
+                  return makeFixedToken(PRAGMA); }
+
+"abstract"      { BEGIN(driver.saveState); return makeFixedToken(ABSTRACT); }
+"action"        { BEGIN(driver.saveState); return makeFixedToken(ACTION); }
+"actions"       { BEGIN(driver.saveState); return makeFixedToken(ACTIONS); }
+"apply"         { BEGIN(driver.saveState); return makeFixedToken(APPLY); }
+"bool"          { BEGIN(driver.saveState); return makeFixedToken(BOOL); }
+"bit"           { BEGIN(driver.saveState); return makeFixedToken(BIT); }
+"const"         { BEGIN(driver.saveState); return makeFixedToken(CONST); }
+"control"       { BEGIN(driver.saveState); return makeFixedToken(CONTROL); }
+"default"       { BEGIN(driver.saveState); return makeFixedToken(DEFAULT); }
+"else"          { BEGIN(driver.saveState); return makeFixedToken(ELSE); }
+"entries"       { BEGIN(driver.saveState); return makeFixedToken(ENTRIES); }
+"enum"          { BEGIN(driver.saveState); return makeFixedToken(ENUM); }
+"error"         { BEGIN(driver.saveState); return makeFixedToken(ERROR); }
+"exit"          { BEGIN(driver.saveState); return makeFixedToken(EXIT); }
+"extern"        { BEGIN(driver.saveState); return makeFixedToken(EXTERN); }
+"false"         { BEGIN(driver.saveState); return makeFixedToken(FALSE); }
+"header"        { BEGIN(driver.saveState); return makeFixedToken(HEADER); }
+"header_union"  { BEGIN(driver.saveState); return makeFixedToken(HEADER_UNION); }
+"if"            { BEGIN(driver.saveState); return makeFixedToken(IF); }
+"in"            { BEGIN(driver.saveState); return makeFixedToken(IN); }
+"inout"         { BEGIN(driver.saveState); return makeFixedToken(INOUT); }
+"int"           { BEGIN(driver.saveState); return makeFixedToken(INT); }
+"key"           { BEGIN(driver.saveState); return makeFixedToken(KEY); }
+"match_kind"    { BEGIN(driver.saveState); return makeFixedToken(MATCH_KIND); }
+"type"          { BEGIN(driver.saveState); return makeFixedToken(TYPE); }
+"out"           { BEGIN(driver.saveState); return makeFixedToken(OUT); }
+"parser"        { BEGIN(driver.saveState); return makeFixedToken(PARSER); }
+"package"       { BEGIN(driver.saveState); return makeFixedToken(PACKAGE); }
+"return"        { BEGIN(driver.saveState); return makeFixedToken(RETURN); }
+"select"        { BEGIN(driver.saveState); return makeFixedToken(SELECT); }
+"state"         { BEGIN(driver.saveState); return makeFixedToken(STATE); }
+"string"        { BEGIN(driver.saveState); return makeFixedToken(STRING); }
+"struct"        { BEGIN(driver.saveState); return makeFixedToken(STRUCT); }
+"switch"        { BEGIN(driver.saveState); return makeFixedToken(SWITCH); }
+"table"         { BEGIN(driver.saveState); return makeFixedToken(TABLE); }
+"this"          { BEGIN(driver.saveState); return makeFixedToken(THIS); }
+"transition"    { BEGIN(driver.saveState); return makeFixedToken(TRANSITION); }
+"true"          { BEGIN(driver.saveState); return makeFixedToken(TRUE); }
+"tuple"         { BEGIN(driver.saveState); return makeFixedToken(TUPLE); }
+"typedef"       { BEGIN(driver.saveState); return makeFixedToken(TYPEDEF); }
+"varbit"        { BEGIN(driver.saveState); return makeFixedToken(VARBIT); }
+"value_set"     { BEGIN(driver.saveState); return makeFixedToken(VALUESET); }
+"void"          { BEGIN(driver.saveState); return makeFixedToken(VOID); }
+"_"             { BEGIN(driver.saveState); return makeFixedToken(DONTCARE); }
 [A-Za-z_][A-Za-z0-9_]* {
                   BEGIN(driver.saveState);
                   cstring name = yytext;
@@ -193,47 +206,47 @@ using Parser = P4::P4Parser;
                           UnparsedConstant constant{yytext, 0, 10, true};
                           return Parser::make_INTEGER(constant, driver.yylloc); }
 
-"&&&"           { BEGIN(driver.saveState); return makeToken(MASK); }
-".."            { BEGIN(driver.saveState); return makeToken(RANGE); }
-"<<"            { BEGIN(driver.saveState); return makeToken(SHL); }
-"&&"            { BEGIN(driver.saveState); return makeToken(AND); }
-"||"            { BEGIN(driver.saveState); return makeToken(OR); }
-"=="            { BEGIN(driver.saveState); return makeToken(EQ); }
-"!="            { BEGIN(driver.saveState); return makeToken(NE); }
-">="            { BEGIN(driver.saveState); return makeToken(GE); }
-"<="            { BEGIN(driver.saveState); return makeToken(LE); }
-"++"            { BEGIN(driver.saveState); return makeToken(PP); }
-
-"+"            { BEGIN(driver.saveState); return makeToken(PLUS); }
-"|+|"          { BEGIN(driver.saveState); return makeToken(PLUS_SAT); }
-"-"            { BEGIN(driver.saveState); return makeToken(MINUS); }
-"|-|"          { BEGIN(driver.saveState); return makeToken(MINUS_SAT); }
-"*"            { BEGIN(driver.saveState); return makeToken(MUL); }
-"/"            { BEGIN(driver.saveState); return makeToken(DIV); }
-"%"            { BEGIN(driver.saveState); return makeToken(MOD); }
-
-"|"            { BEGIN(driver.saveState); return makeToken(BIT_OR); }
-"&"            { BEGIN(driver.saveState); return makeToken(BIT_AND); }
-"^"            { BEGIN(driver.saveState); return makeToken(BIT_XOR); }
-"~"            { BEGIN(driver.saveState); return makeToken(COMPLEMENT); }
-
-"("            { BEGIN(driver.saveState); return makeToken(L_PAREN); }
-")"            { BEGIN(driver.saveState); return makeToken(R_PAREN); }
-"["            { BEGIN(driver.saveState); return makeToken(L_BRACKET); }
-"]"            { BEGIN(driver.saveState); return makeToken(R_BRACKET); }
-"{"            { BEGIN(driver.saveState); return makeToken(L_BRACE); }
-"}"            { BEGIN(driver.saveState); return makeToken(R_BRACE); }
-"<"            { BEGIN(driver.saveState); return makeToken(L_ANGLE); }
-">"            { BEGIN(driver.saveState); return makeToken(R_ANGLE); }
-
-"!"            { BEGIN(driver.saveState); return makeToken(NOT); }
-":"            { BEGIN(driver.saveState); return makeToken(COLON); }
-","            { BEGIN(driver.saveState); return makeToken(COMMA); }
-"?"            { BEGIN(driver.saveState); return makeToken(QUESTION); }
-"."            { BEGIN(driver.saveState); return makeToken(DOT); }
-"="            { BEGIN(driver.saveState); return makeToken(ASSIGN); }
-";"            { BEGIN(driver.saveState); return makeToken(SEMICOLON); }
-"@"            { BEGIN(driver.saveState); return makeToken(AT); }
+"&&&"           { BEGIN(driver.saveState); return makeFixedToken(MASK); }
+".."            { BEGIN(driver.saveState); return makeFixedToken(RANGE); }
+"<<"            { BEGIN(driver.saveState); return makeFixedToken(SHL); }
+"&&"            { BEGIN(driver.saveState); return makeFixedToken(AND); }
+"||"            { BEGIN(driver.saveState); return makeFixedToken(OR); }
+"=="            { BEGIN(driver.saveState); return makeFixedToken(EQ); }
+"!="            { BEGIN(driver.saveState); return makeFixedToken(NE); }
+">="            { BEGIN(driver.saveState); return makeFixedToken(GE); }
+"<="            { BEGIN(driver.saveState); return makeFixedToken(LE); }
+"++"            { BEGIN(driver.saveState); return makeFixedToken(PP); }
+
+"+"            { BEGIN(driver.saveState); return makeFixedToken(PLUS); }
+"|+|"          { BEGIN(driver.saveState); return makeFixedToken(PLUS_SAT); }
+"-"            { BEGIN(driver.saveState); return makeFixedToken(MINUS); }
+"|-|"          { BEGIN(driver.saveState); return makeFixedToken(MINUS_SAT); }
+"*"            { BEGIN(driver.saveState); return makeFixedToken(MUL); }
+"/"            { BEGIN(driver.saveState); return makeFixedToken(DIV); }
+"%"            { BEGIN(driver.saveState); return makeFixedToken(MOD); }
+
+"|"            { BEGIN(driver.saveState); return makeFixedToken(BIT_OR); }
+"&"            { BEGIN(driver.saveState); return makeFixedToken(BIT_AND); }
+"^"            { BEGIN(driver.saveState); return makeFixedToken(BIT_XOR); }
+"~"            { BEGIN(driver.saveState); return makeFixedToken(COMPLEMENT); }
+
+"("            { BEGIN(driver.saveState); return makeFixedToken(L_PAREN); }
+")"            { BEGIN(driver.saveState); return makeFixedToken(R_PAREN); }
+"["            { BEGIN(driver.saveState); return makeFixedToken(L_BRACKET); }
+"]"            { BEGIN(driver.saveState); return makeFixedToken(R_BRACKET); }
+"{"            { BEGIN(driver.saveState); return makeFixedToken(L_BRACE); }
+"}"            { BEGIN(driver.saveState); return makeFixedToken(R_BRACE); }
+"<"            { BEGIN(driver.saveState); return makeFixedToken(L_ANGLE); }
+">"            { BEGIN(driver.saveState); return makeFixedToken(R_ANGLE); }
+
+"!"            { BEGIN(driver.saveState); return makeFixedToken(NOT); }
+":"            { BEGIN(driver.saveState); return makeFixedToken(COLON); }
+","            { BEGIN(driver.saveState); return makeFixedToken(COMMA); }
+"?"            { BEGIN(driver.saveState); return makeFixedToken(QUESTION); }
+"."            { BEGIN(driver.saveState); return makeFixedToken(DOT); }
+"="            { BEGIN(driver.saveState); return makeFixedToken(ASSIGN); }
+";"            { BEGIN(driver.saveState); return makeFixedToken(SEMICOLON); }
+"@"            { BEGIN(driver.saveState); return makeFixedToken(AT); }
 
 <*>.|\n        { return makeToken(UNEXPECTED_TOKEN); }
 
@@ -39,35 +39,45 @@ limitations under the License.
 
 IRNODE_ALL_TEMPLATES(DEFINE_APPLY_FUNCTIONS, inline)
 
-template<class T> void IR::Vector<T>::visit_children(Visitor &v) {
-    for (auto i = vec.begin(); i != vec.end();) {
-        auto n = v.apply_visitor(*i);
-        if (!n && *i) {
-            i = erase(i);
-        } else if (n == *i) {
-            i++;
-        } else if (auto l = dynamic_cast<const Vector *>(n)) {
-            i = erase(i);
-            i = insert(i, l->vec.begin(), l->vec.end());
-            i += l->vec.size();
-        } else if (auto v = dynamic_cast<const VectorBase *>(n)) {
-            if (v->empty()) {
-                i = erase(i);
-            } else {
-                i = insert(i, v->size() - 1, nullptr);
-                for (auto el : *v) {
-                    if (auto e = dynamic_cast<const T *>(el))
-                        *i++ = e;
-                    else
-                        BUG("visitor returned invalid type %s for Vector<%s>",
-                            e->node_type_name(), T::static_type_name()); } }
-        } else if (auto e = dynamic_cast<const T *>(n)) {
-            *i++ = e;
-        } else {
+template<class T> void IR::Vector<T>::visit_result(iterator i, const Node *n,
+                                                   safe_vector<const T *> &result,
+                                                   bool &spliced) {
+    const T *e = nullptr;
+    if (n == *i) {
+        e = *i;
+    } else if (n && !dynamic_cast<const VectorBase *>(n)) {
+        e = dynamic_cast<const T *>(n);
+        if (!e)
             BUG("visitor returned invalid type %s for Vector<%s>",
                 n->node_type_name(), T::static_type_name());
-        }
-    }
+    } else {
+        // removed or expanded
+        if (!spliced) {
+            result.reserve(vec.size());
+            result.insert(result.end(), vec.begin(), i);
+            spliced = true; }
+        if (auto l = dynamic_cast<const Vector *>(n)) {
+            result.insert(result.end(), l->vec.begin(), l->vec.end());
+        } else if (auto v = dynamic_cast<const VectorBase *>(n)) {
+            for (auto el : *v) {
+                if (auto t = dynamic_cast<const T *>(el))
+                    result.push_back(t);
+                else
+                    BUG("visitor returned invalid type %s for Vector<%s>",
+                        el->node_type_name(), T::static_type_name()); } }
+        return; }
+    if (spliced)
+        result.push_back(e);
+    else
+        *i = e;
+}
+template<class T> void IR::Vector<T>::visit_children(Visitor &v) {
+    safe_vector<const T *> result;
+    bool spliced = false;
+    for (auto i = vec.begin(); i != vec.end(); ++i)
+        visit_result(i, v.apply_visitor(*i), result, spliced);
+    if (spliced)
+        vec = std::move(result);
 }
 template<class T> void IR::Vector<T>::visit_children(Visitor &v) const {
     for (auto &a : vec) v.visit(a); }
@@ -75,37 +85,16 @@ template<class T> void IR::Vector<T>::parallel_visit_children(Visitor &v) {
     Visitor *start = nullptr, *tmp = &v;
     size_t todo = vec.size();
     if (todo > 1) start = &v.flow_clone();
-    for (auto i = vec.begin(); i != vec.end(); --todo, tmp = nullptr) {
+    safe_vector<const T *> result;
+    bool spliced = false;
+    for (auto i = vec.begin(); i != vec.end(); ++i, --todo, tmp = nullptr) {
         if (!tmp)
             tmp = todo > 1 ? &start->flow_clone() : start;
-        auto n = tmp->apply_visitor(*i);
-        if (!n && *i) {
-            i = erase(i);
-        } else if (n == *i) {
-            i++;
-        } else if (auto l = dynamic_cast<const Vector *>(n)) {
-            i = erase(i);
-            i = insert(i, l->vec.begin(), l->vec.end());
-            i += l->vec.size();
-        } else if (auto v = dynamic_cast<const VectorBase *>(n)) {
-            if (v->empty()) {
-                i = erase(i);
-            } else {
-                i = insert(i, v->size() - 1, nullptr);
-                for (auto el : *v) {
-                    if (auto e = dynamic_cast<const T *>(el))
-                        *i++ = e;
-                    else
-                        BUG("visitor returned invalid type %s for Vector<%s>",
-                            e->node_type_name(), T::static_type_name()); } }
-        } else if (auto e = dynamic_cast<const T *>(n)) {
-            *i++ = e;
-        } else {
-            BUG("visitor returned invalid type %s for Vector<%s>",
-                n->node_type_name(), T::static_type_name());
-        }
+        visit_result(i, tmp->apply_visitor(*i), result, spliced);
         if (tmp != &v)
             v.flow_merge(*tmp); }
+    if (spliced)
+        vec = std::move(result);
 }
 template<class T> void IR::Vector<T>::parallel_visit_children(Visitor &v) const {
     Visitor *start = nullptr, *tmp = &v;
@@ -136,23 +125,41 @@ template<class T> void IR::Vector<T>::toJSON(JSONGenerator &json) const {
 std::ostream &operator<<(std::ostream &out, const IR::Vector<IR::Expression> &v);
 
 template<class T> void IR::IndexedVector<T>::visit_children(Visitor &v) {
-    for (auto i = begin(); i != end();) {
+    // As in Vector<T>::visit_result, elements are collected in a new vector
+    // once one is removed or expanded
+    safe_vector<const T *> result;
+    bool spliced = false;
+    for (auto i = begin(); i != end(); ++i) {
         auto n = v.apply_visitor(*i);
-        if (!n && *i) {
-            i = erase(i);
-        } else if (n == *i) {
-            i++;
-        } else if (auto l = dynamic_cast<const Vector<T> *>(n)) {
-            i = erase(i);
-            i = insert(i, l->begin(), l->end());
-            i += l->Vector<T>::size();
-        } else if (auto e = dynamic_cast<const T *>(n)) {
-            i = replace(i, e);
-        } else {
+        if (n == *i) {
+            if (spliced)
+                result.push_back(*i);
+            continue; }
+        auto l = dynamic_cast<const Vector<T> *>(n);
+        auto e = dynamic_cast<const T *>(n);
+        if (!l && e) {
+            removeFromMap(*i);
+            insertInMap(e);
+            if (spliced)
+                result.push_back(e);
+            else
+                *i = e;
+            continue; }
+        if (n && !l)
             BUG("visitor returned invalid type %s for IndexedVector<%s>",
                 n->node_type_name(), T::static_type_name());
-        }
+        if (!spliced) {
+            result.reserve(Vector<T>::size());
+            result.insert(result.end(), begin(), i);
+            spliced = true; }
+        removeFromMap(*i);
+        if (l) {
+            for (auto el : *l)
+                insertInMap(el);
+            result.insert(result.end(), l->begin(), l->end()); }
     }
+    if (spliced)
+        this->set_contents(std::move(result));
 }
 template<class T> void IR::IndexedVector<T>::visit_children(Visitor &v) const {
     for (auto &a : *this) v.visit(a); }
@@ -0,0 +1,199 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "config.h"
+#if HAVE_LIBGC
+#include <gc/gc.h>
+#endif  /* HAVE_LIBGC */
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+#include "mem_accounting.h"
+#include "lib/gc.h"
+#include "lib/n4.h"
+
+namespace IR {
+
+bool MemoryAccounting::enabled = false;
+#if HAVE_LIBGC
+const bool MemoryAccounting::gcFinalizers = true;
+#else
+const bool MemoryAccounting::gcFinalizers = false;
+#endif  /* HAVE_LIBGC */
+
+namespace {
+
+struct PassFrame {
+    size_t      heap, ir;                       // counters when the pass started
+    size_t      childHeap = 0, childIr = 0;     // allocated by nested passes
+    PassFrame(size_t heap, size_t ir) : heap(heap), ir(ir) {}
+};
+
+struct PassAccount {
+    unsigned    runs = 0;
+    size_t      heap = 0, ir = 0;               // including nested passes
+    size_t      selfHeap = 0, selfIr = 0;       // excluding nested passes
+};
+
+// The accounts are never destroyed: --mem-report prints them from an
+// atexit handler, which may run after the destruction of statics
+// constructed once the handler was registered.
+std::vector<MemoryAccounting::Account *> &accounts() {
+    static auto accounts = new std::vector<MemoryAccounting::Account *>;
+    return *accounts; }
+
+std::map<cstring, PassAccount> &passAccounts() {
+    static auto passes = new std::map<cstring, PassAccount>;
+    return *passes; }
+
+thread_local std::vector<PassFrame> passStack;
+
+// Bytes allocated for IR nodes so far
+size_t irBytes = 0;
+
+#ifdef MULTITHREAD
+// Recursive, since finalizers can run when allocating with the lock held.
+std::recursive_mutex &accountingLock() {
+    static auto lock = new std::recursive_mutex;
+    return *lock; }
+#define LOCK_ACCOUNTING std::lock_guard<std::recursive_mutex> acquire(accountingLock())
+#else
+#define LOCK_ACCOUNTING
+#endif  // MULTITHREAD
+
+#if HAVE_LIBGC
+void collected(void *, void *account) {
+    LOCK_ACCOUNTING;
+    static_cast<MemoryAccounting::Account *>(account)->live--; }
+#endif  /* HAVE_LIBGC */
+
+}  // namespace
+
+MemoryAccounting::Account &MemoryAccounting::registerClass(cstring name) {
+    LOCK_ACCOUNTING;
+    auto account = new Account(name);
+    accounts().push_back(account);
+    return *account; }
+
+void MemoryAccounting::allocated(Account &a, void *p, size_t size) {
+    {
+        LOCK_ACCOUNTING;
+        a.size = size;
+        a.allocated++;
+        a.live++;
+        irBytes += size;
+    }
+#if HAVE_LIBGC
+    GC_register_finalizer_no_order(p, collected, &a, nullptr, nullptr);
+#else
+    (void)p;
+#endif  /* HAVE_LIBGC */
+}
+
+void MemoryAccounting::freed(Account &a, void *p) {
+#if HAVE_LIBGC
+    // Nodes allocated before accounting was enabled have no finalizer
+    // and were not counted.
+    GC_finalization_proc fn = nullptr;
+    void *cd = nullptr;
+    GC_register_finalizer_no_order(p, nullptr, nullptr, &fn, &cd);
+    if (cd == nullptr) return;
+#else
+    (void)p;
+#endif  /* HAVE_LIBGC */
+    LOCK_ACCOUNTING;
+    if (a.live > 0) a.live--;
+}
+
+void MemoryAccounting::passStarted() {
+    size_t ir;
+    {
+        LOCK_ACCOUNTING;
+        ir = irBytes;
+    }
+    passStack.emplace_back(gc_mem_allocated(), ir);
+}
+
+void MemoryAccounting::passEnded(const char *name) {
+    // a pass may start before accounting is enabled
+    if (passStack.empty()) return;
+    size_t heap = gc_mem_allocated() - passStack.back().heap;
+    LOCK_ACCOUNTING;
+    size_t ir = irBytes - passStack.back().ir;
+    auto &pass = passAccounts()[name];
+    pass.runs++;
+    pass.heap += heap;
+    pass.ir += ir;
+    pass.selfHeap += heap - std::min(heap, passStack.back().childHeap);
+    pass.selfIr += ir - std::min(ir, passStack.back().childIr);
+    passStack.pop_back();
+    if (!passStack.empty()) {
+        passStack.back().childHeap += heap;
+        passStack.back().childIr += ir; }
+}
+
+void MemoryAccounting::report(std::ostream &out, unsigned top) {
+#if HAVE_LIBGC
+    // update the live counts
+    GC_gcollect();
+    GC_invoke_finalizers();
+#endif  /* HAVE_LIBGC */
+    LOCK_ACCOUNTING;
+    std::vector<const Account *> classes(accounts().begin(), accounts().end());
+    std::sort(classes.begin(), classes.end(), [](const Account *a, const Account *b) {
+        return a->allocated * a->size > b->allocated * b->size; });
+    size_t total = 0, live = 0;
+    for (auto a : classes) {
+        total += a->allocated * a->size;
+        live += a->live * a->size; }
+    out << "IR nodes: " << n4(total) << "B allocated, " << n4(live) << "B live" << std::endl;
+    out << std::setw(40) << std::left << "node class" << std::right
+        << " count   bytes  live l.bytes" << std::endl;
+    unsigned count = 0;
+    for (auto a : classes) {
+        if (count++ == top || a->allocated == 0) break;
+        out << std::setw(40) << std::left << a->name << std::right
+            << "  " << n4(a->allocated) << "   " << n4(a->allocated * a->size) << "B"
+            << "  " << n4(a->live) << "   " << n4(a->live * a->size) << "B" << std::endl; }
+
+    std::vector<std::pair<cstring, const PassAccount *>> passes;
+    for (auto &p : passAccounts())
+        passes.emplace_back(p.first, &p.second);
+    std::stable_sort(passes.begin(), passes.end(),
+                     [](const std::pair<cstring, const PassAccount *> &a,
+                        const std::pair<cstring, const PassAccount *> &b) {
+        if (a.second->selfHeap != b.second->selfHeap)
+            return a.second->selfHeap > b.second->selfHeap;
+        return a.second->selfIr > b.second->selfIr; });
+    out << std::endl << "Memory allocated by passes (s. excludes nested passes):" << std::endl;
+    out << std::setw(40) << std::left << "pass" << std::right
+        << "  runs    heap  s.heap      IR    s.IR" << std::endl;
+    count = 0;
+    for (auto &p : passes) {
+        if (count++ == top) break;
+        auto pass = p.second;
+        out << std::setw(40) << std::left << p.first << std::right
+            << "  " << n4(pass->runs) << "   " << n4(pass->heap) << "B"
+            << "   " << n4(pass->selfHeap) << "B   " << n4(pass->ir) << "B"
+            << "   " << n4(pass->selfIr) << "B" << std::endl; }
+}
+
+}  // namespace IR
@@ -0,0 +1,82 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _IR_MEM_ACCOUNTING_H_
+#define _IR_MEM_ACCOUNTING_H_
+
+#include <cstddef>
+#include <iosfwd>
+#include <new>
+#include "lib/cstring.h"
+
+namespace IR {
+
+/// Counts the IR nodes allocated and still live per node class, and the
+/// memory allocated by each pass.  Disabled by default: when disabled the
+/// only costs are a test in the operator new of the node classes and,
+/// with the garbage collector, a finalizer lookup when a node is deleted.
+/// Nodes are counted by the class-specific operator new declared by
+/// IRNODE_SUBCLASS, so nodes which are not heap-allocated (locals, inline
+/// fields) are not counted.  With the garbage collector, nodes are live
+/// until they are collected or deleted; without it, until deleted.
+class MemoryAccounting {
+ public:
+    struct Account {
+        cstring         name;
+        size_t          size = 0;       // sizeof the node class
+        size_t          allocated = 0;  // number of nodes allocated
+        size_t          live = 0;       // number of nodes not freed yet
+        explicit Account(cstring name) : name(name) {}
+    };
+
+    static bool enabled;
+    static void enable() { enabled = true; }
+    static void disable() { enabled = false; }
+
+    template<class T> static void *allocate(size_t size) {
+        void *rv = ::operator new(size);
+        if (enabled) allocated(account<T>(), rv, size);
+        return rv; }
+    template<class T> static void deallocate(void *p) {
+        // Nodes counted before accounting was disabled still have a
+        // finalizer, which must not outlive them.
+        if (enabled || gcFinalizers) freed(account<T>(), p);
+        ::operator delete(p); }
+
+    /// Called by the pass profiler when a visitor starts and ends;
+    /// calls must be nested.
+    static void passStarted();
+    static void passEnded(const char *name);
+
+    /// Prints the 'top' node classes and passes which allocated the
+    /// most memory.
+    static void report(std::ostream &out, unsigned top = 20);
+
+ private:
+    template<class T> static Account &account() {
+        static Account &a = registerClass(T::static_type_name());
+        return a; }
+    /// True when allocated nodes are given a finalizer by the garbage
+    /// collector to update the live counts.
+    static const bool gcFinalizers;
+    static Account &registerClass(cstring name);
+    static void allocated(Account &a, void *p, size_t size);
+    static void freed(Account &a, void *p);
+};
+
+}  // namespace IR
+
+#endif /* _IR_MEM_ACCOUNTING_H_ */
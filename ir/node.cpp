@@ -17,13 +17,29 @@ limitations under the License.
 #include "ir.h"
 #include "ir/json_loader.h"
 
-void IR::Node::traceVisit(const char* visitor) const
-{ LOG3("Visiting " << visitor << " " << id << ":" << node_type_name()); }
+#if IR_TRACING
+// Visits and node creations are traced in the log of this file; its
+// level is cached, since it is checked for every node.
+Log::Detail::FileLogLevelCache IR::Node::traceLevel(__FILE__);
+
+void IR::Node::traceVisitSlow(const char* visitor) const {
+    ::Log::Detail::fileLogOutput(__FILE__) << ::Log::Detail::OutputLogPrefix(__FILE__, 3)
+        << "Visiting " << visitor << " " << id << ":" << node_type_name() << std::endl;
+}
 
-void IR::Node::traceCreation() const { LOG5("Created node " << id); }
+void IR::Node::traceCreationSlow() const {
+    ::Log::Detail::fileLogOutput(__FILE__) << ::Log::Detail::OutputLogPrefix(__FILE__, 5)
+        << "Created node " << id << std::endl;
+}
+#endif  // IR_TRACING
 
 int IR::Node::currentId = 0;
 
+const IR::ChildFields &IR::Node::child_fields() const {
+    static const ChildFields rv(ChildFields::Custom);
+    return rv;
+}
+
 void IR::Node::toJSON(JSONGenerator &json) const {
     json << json.indent << "\"Node_ID\" : " << id << "," << std::endl
          << json.indent << "\"Node_Type\" : " << node_type_name();
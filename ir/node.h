@@ -23,6 +23,7 @@ limitations under the License.
 #include "lib/indent.h"
 #include "lib/source_file.h"
 #include "ir-tree-macros.h"
+#include "mem_accounting.h"
 #include "lib/log.h"
 #include "lib/json.h"
 
@@ -40,6 +41,41 @@ class Annotation;
 
 template<class T> class Vector;
 template<class T> class IndexedVector;
+
+/// One child of an IR class, as visited by the generated visit_children.
+struct ChildField {
+    const char  *name;
+    /// Returns the child of a node, or the field itself for an inline field.
+    const Node  *(*get)(const Node *);
+    bool        isInline;
+};
+
+/// Table of the children of an IR class, in the order visit_children visits
+/// them.  Generated by the ir-generator for each IR class, so read-only
+/// traversals (Inspector) can iterate over the children of a node without
+/// calling visit_children and going through the Visitor::visit overloads.
+class ChildFields {
+    const ChildField    *begin_ = nullptr, *end_ = nullptr;
+
+ public:
+    enum kind_t {
+        Fields,     // the fields of 'parent' (if any), then the fields in this table
+        Elements,   // the elements of a VectorBase
+        Custom      // visit_children is user-defined, so must be called
+    };
+    const kind_t        kind;
+    const ChildFields   *const parent = nullptr;
+
+    explicit ChildFields(kind_t kind) : kind(kind) {}
+    explicit ChildFields(const ChildFields *parent)
+        : kind(parent && parent->kind != Fields ? Custom : Fields), parent(parent) {}
+    template<size_t N> ChildFields(const ChildField (&fields)[N], const ChildFields *parent)
+        : begin_(fields), end_(fields + N),
+          kind(parent && parent->kind != Fields ? Custom : Fields), parent(parent) {}
+    const ChildField *begin() const { return begin_; }
+    const ChildField *end() const { return end_; }
+};
+
 // node interface
 class INode : public Util::IHasSourceInfo, public IHasDbPrint {
  public:
@@ -71,7 +107,15 @@ class Node : public virtual INode {
 
  protected:
     static int currentId;
-    void traceVisit(const char* visitor) const;
+#if IR_TRACING
+    static Log::Detail::FileLogLevelCache traceLevel;
+    void traceVisitSlow(const char* visitor) const;
+    void traceCreationSlow() const;
+    void traceVisit(const char* visitor) const
+    { if (3 <= MAX_LOGGING_LEVEL && traceLevel.isAtLeast(3)) traceVisitSlow(visitor); }
+#else
+    void traceVisit(const char*) const {}
+#endif  // IR_TRACING
     virtual void visit_children(Visitor &) { }
     virtual void visit_children(Visitor &) const { }
     friend class ::Visitor;
@@ -86,7 +130,12 @@ class Node : public virtual INode {
     Util::SourceInfo    srcInfo;
     int id;  // unique id for each node
     int clone_id;  // unique id this node was cloned from (recursively)
-    void traceCreation() const;
+#if IR_TRACING
+    void traceCreation() const
+    { if (5 <= MAX_LOGGING_LEVEL && traceLevel.isAtLeast(5)) traceCreationSlow(); }
+#else
+    void traceCreation() const {}
+#endif  // IR_TRACING
     Node() : id(currentId++), clone_id(id) { traceCreation(); }
     explicit Node(Util::SourceInfo si) : srcInfo(si), id(currentId++), clone_id(id) {
         traceCreation(); }
@@ -104,6 +153,9 @@ class Node : public virtual INode {
     cstring node_type_name() const override { return "Node"; }
     static cstring static_type_name() { return "Node"; }
     virtual int num_children() { return 0; }
+    /// Describes the children visited by visit_children; classes with no
+    /// generated table must have their visit_children called.
+    virtual const ChildFields &child_fields() const;
     template<typename T> bool is() const { return to<T>() != nullptr; }
     template<typename T> const T *to() const { return dynamic_cast<const T*>(this); }
     template<typename T> const T &as() const { return dynamic_cast<const T&>(*this); }
@@ -151,6 +203,10 @@ inline bool equal(const INode *a, const INode *b) {
 #define IRNODE_COMMON_SUBCLASS(T)                                           \
  public:                                                                    \
     using Node::operator==;                                                 \
+    static void *operator new(size_t size)                                  \
+    { return IR::MemoryAccounting::allocate<T>(size); }                     \
+    static void operator delete(void *p)                                    \
+    { IR::MemoryAccounting::deallocate<T>(p); }                             \
     bool apply_visitor_preorder(Modifier &v) override;                      \
     void apply_visitor_postorder(Modifier &v) override;                     \
     void apply_visitor_revisit(Modifier &v, const Node *n) const override;  \
@@ -39,6 +39,9 @@ class VectorBase : public Node {
     virtual bool empty() const = 0;
     iterator begin() const { return VectorBase_begin(); }
     iterator end() const { return VectorBase_end(); }
+    const ChildFields &child_fields() const override {
+        static const ChildFields rv(ChildFields::Elements);
+        return rv; }
     VectorBase() = default;
     VectorBase(const VectorBase &) = default;
     VectorBase(VectorBase &&) = default;
@@ -74,12 +77,12 @@ class Vector : public VectorBase {
     const_iterator begin() const { return vec.begin(); }
     VectorBase::iterator VectorBase_begin() const override {
         /* DANGER -- works as long as IR::Node is the first ultimate base class of T */
-        return reinterpret_cast<VectorBase::iterator>(&vec[0]); }
+        return reinterpret_cast<VectorBase::iterator>(vec.data()); }
     iterator end() { return vec.end(); }
     const_iterator end() const { return vec.end(); }
     VectorBase::iterator VectorBase_end() const override {
         /* DANGER -- works as long as IR::Node is the first ultimate base class of T */
-        return reinterpret_cast<VectorBase::iterator>(&vec[0] + vec.size()); }
+        return reinterpret_cast<VectorBase::iterator>(vec.data() + vec.size()); }
     std::reverse_iterator<iterator> rbegin() { return vec.rbegin(); }
     std::reverse_iterator<const_iterator> rbegin() const { return vec.rbegin(); }
     std::reverse_iterator<iterator> rend() { return vec.rend(); }
@@ -191,6 +194,13 @@ class Vector : public VectorBase {
     Util::Enumerator<const S*>* only() const {
         std::function<bool(const T*)> filter = [](const T* d) { return d->template is<S>(); };
         return getEnumerator()->where(filter)->template as<const S*>(); }
+
+ protected:
+    /* Used by visit_children to store 'n', the result of visiting the element at 'i'.
+     * Once an element is removed or expanded, all elements are collected in 'result'
+     * rather than spliced in place, which would make removing many elements quadratic */
+    void visit_result(iterator i, const Node *n, safe_vector<const T *> &result, bool &spliced);
+    void set_contents(safe_vector<const T *> &&v) { vec = std::move(v); }
 };
 
 }  // namespace IR
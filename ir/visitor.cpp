@@ -165,6 +165,8 @@ Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
     LOG3(profile_indent << v.name() << " statrting at +" <<
          (first_start ? start - first_start : (first_start = start, 0UL))/1000000.0 << " msec");
     ++profile_indent;
+    if (IR::MemoryAccounting::enabled)
+        IR::MemoryAccounting::passStarted();
 }
 Visitor::profile_t::profile_t(profile_t &&a) : v(a.v), start(a.start) {
     a.start = 0;
@@ -181,7 +183,9 @@ Visitor::profile_t::~profile_t() {
         ts.tv_sec = ts.tv_nsec = 0;
 #endif
         uint64_t end = ts.tv_sec*1000000000UL + ts.tv_nsec + 1;
-        LOG1(profile_indent << v.name() << ' ' << (end-start)/1000.0 << " usec"); }
+        LOG1(profile_indent << v.name() << ' ' << (end-start)/1000.0 << " usec");
+        if (IR::MemoryAccounting::enabled)
+            IR::MemoryAccounting::passEnded(v.name()); }
 }
 
 void Visitor::print_context() const {
@@ -253,7 +257,9 @@ const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
                 visitCurrentOnce = visited->refVisitOnce(n);
                 copy->apply_visitor_postorder(*this); }
             if (visited->finish(n, copy))
-                (n = copy)->validate(); } }
+                (n = copy)->validate();
+            else if (deleteUnchangedClones)
+                delete copy; } }
     if (ctxt)
         ctxt->child_index++;
     else
@@ -274,7 +280,7 @@ const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
             vp.first->second.done = false;
             visitCurrentOnce = &vp.first->second.visitOnce;
             if (n->apply_visitor_preorder(*this)) {
-                n->visit_children(*this);
+                visit_children_of(n);
                 visitCurrentOnce = &vp.first->second.visitOnce;
                 n->apply_visitor_postorder(*this); }
             if (vp.first != visited->find(n))
@@ -330,8 +336,11 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
                 && final_result != preorder_result
                 && *final_result == *preorder_result)
                 final_result = preorder_result;
-            if (visited->finish(n, final_result) && (n = final_result))
-                final_result->validate();
+            if (visited->finish(n, final_result)) {
+                if ((n = final_result))
+                    final_result->validate();
+            } else if (deleteUnchangedClones && final_result == copy && !extra_clone) {
+                delete copy; }
             if (extra_clone)
                 visited->finish(preorder_result, final_result); } }
     if (ctxt)
@@ -341,6 +350,34 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
     return n;
 }
 
+/* Equivalent to n->visit_children(*this), using the table of children generated for
+ * each IR class when there is one */
+void Inspector::visit_children_of(const IR::Node *n) {
+    auto &fields = n->child_fields();
+    switch (fields.kind) {
+    case IR::ChildFields::Fields:
+        visit_fields(n, fields);
+        break;
+    case IR::ChildFields::Elements:
+        for (auto el : *static_cast<const IR::VectorBase *>(n))
+            apply_visitor(el);
+        break;
+    case IR::ChildFields::Custom:
+        n->visit_children(*this);
+        break; }
+}
+
+void Inspector::visit_fields(const IR::Node *n, const IR::ChildFields &fields) {
+    if (fields.parent)
+        visit_fields(n, *fields.parent);
+    for (auto &f : fields) {
+        auto child = f.get(n);
+        if (f.isInline)
+            visit_children_of(child);
+        else
+            apply_visitor(child, f.name); }
+}
+
 void Inspector::revisit_visited() {
     for (auto it = visited->begin(); it != visited->end();) {
         if (it->second.done)
@@ -202,6 +202,13 @@ class Visitor {
     // pass, this will result in them being duplicated if they are modified.
     bool visitDagOnce = true;
     bool dontForwardChildrenBeforePreorder = false;
+    // Modifier and Transform clone every node before calling its preorder, and
+    // drop the clone if the node turns out to be unchanged.  If
+    // deleteUnchangedClones is 'true', such clones are freed immediately rather
+    // than left to the garbage collector.  This is only safe if the visitor never
+    // keeps a pointer to the node being visited or to one of its context nodes
+    // (findContext) -- getOriginal() must be used for anything which is kept.
+    bool deleteUnchangedClones = false;
     // if joinFlows is 'true', Visitor will track nodes with more than one parent and
     // flow_merge the visitor from all the parents before visiting the node and its
     // children.  This only works for Inspector (not Modifier/Transform) currently.
@@ -273,6 +280,8 @@ class Inspector : public virtual Visitor {
     typedef std::unordered_map<const IR::Node *, info_t>       visited_t;
     visited_t   *visited = nullptr;
     bool check_clone(const Visitor *) override;
+    void visit_children_of(const IR::Node *n);
+    void visit_fields(const IR::Node *n, const IR::ChildFields &fields);
  public:
     profile_t init_apply(const IR::Node *root) override;
     const IR::Node *apply_visitor(const IR::Node *, const char *name = 0) override;
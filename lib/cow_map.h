@@ -0,0 +1,96 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef P4C_LIB_COW_MAP_H_
+#define P4C_LIB_COW_MAP_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+
+/// A std::map with copy-on-write semantics: copying a cow_map is O(1),
+/// and the underlying map is only duplicated by the first modification
+/// of a copy which still shares it.  All the lookup methods are const;
+/// the map can only be changed through the reference returned by
+/// modify(), which makes the points where a copy can happen explicit.
+/// Not thread-safe: copies must be modified from a single thread.
+template <class K, class V, class COMP = std::less<K>>
+class cow_map {
+ public:
+    typedef std::map<K, V, COMP>                        map_type;
+    typedef typename map_type::key_type                 key_type;
+    typedef typename map_type::mapped_type              mapped_type;
+    typedef typename map_type::value_type               value_type;
+    typedef typename map_type::size_type                size_type;
+    typedef typename map_type::const_iterator           const_iterator;
+    typedef const_iterator                              iterator;
+
+ private:
+    std::shared_ptr<map_type>   data;
+
+    static const map_type &empty_map() {
+        static const map_type empty;
+        return empty; }
+    const map_type &read() const { return data ? *data : empty_map(); }
+
+ public:
+    cow_map() = default;
+    cow_map(const cow_map &) = default;
+    cow_map(cow_map &&) = default;
+    cow_map &operator=(const cow_map &) = default;
+    cow_map &operator=(cow_map &&) = default;
+
+    const_iterator begin() const { return read().begin(); }
+    const_iterator end() const { return read().end(); }
+    const_iterator find(const key_type &k) const { return read().find(k); }
+    const_iterator lower_bound(const key_type &k) const { return read().lower_bound(k); }
+    const_iterator upper_bound(const key_type &k) const { return read().upper_bound(k); }
+    size_type count(const key_type &k) const { return read().count(k); }
+    size_type size() const { return read().size(); }
+    bool empty() const { return read().empty(); }
+    const mapped_type &at(const key_type &k) const { return read().at(k); }
+
+    /// True if both maps share their contents, so are known to be equal
+    /// without comparing them.
+    bool shares(const cow_map &other) const { return data == other.data; }
+
+    /// Access the map for modification; duplicates it first if it is
+    /// shared with a copy.  References and iterators obtained before the
+    /// call may refer to the old copy.
+    map_type &modify() {
+        if (!data)
+            data = std::make_shared<map_type>();
+        else if (data.use_count() > 1)
+            data = std::make_shared<map_type>(*data);
+        return *data; }
+    void clear() { data.reset(); }
+
+    bool operator==(const cow_map &a) const { return shares(a) || read() == a.read(); }
+    bool operator!=(const cow_map &a) const { return !(*this == a); }
+};
+
+namespace GetImpl {
+
+template<class K, class T, class V, class Comp>
+inline const V *getref(const cow_map<K, V, Comp> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+}  // namespace GetImpl
+using namespace GetImpl;  // NOLINT(build/namespaces)
+
+#endif /* P4C_LIB_COW_MAP_H_ */
@@ -18,6 +18,9 @@ limitations under the License.
 
 #include <string>
 #include <unordered_set>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 
 #include "hash.h"
 
@@ -146,7 +149,19 @@ std::unordered_set<table_entry>& cache() {
     return g_cache;
 }
 
+#ifdef MULTITHREAD
+// Builds with MULTITHREAD defined (ENABLE_MULTITHREAD) may create cstrings
+// from several threads, so all accesses to the cache are serialized.
+std::mutex &cache_lock() {
+    static std::mutex lock;
+    return lock;
+}
+#endif  // MULTITHREAD
+
 const char *save_to_cache(const char *string, std::size_t length, table_entry_flags flags) {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(cache_lock());
+#endif  // MULTITHREAD
     if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
         return cache().emplace(string, length, flags).first->string();
     }
@@ -177,6 +192,9 @@ void cstring::construct_from_literal(const char *string, std::size_t length) {
 }
 
 size_t cstring::cache_size(size_t &count) {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(cache_lock());
+#endif  // MULTITHREAD
     size_t rv = 0;
     count = cache().size();
     for (auto &s : cache())
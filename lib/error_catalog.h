@@ -99,15 +99,17 @@ class ErrorCatalog {
 
     /// retrieve the name for errorCode
     const char *getName(int errorCode) {
-        if (errorCatalog.count(errorCode))
-            return errorCatalog.at(errorCode).first;
+        auto it = errorCatalog.find(errorCode);
+        if (it != errorCatalog.end())
+            return it->second.first;
         return "--unknown--";
     }
 
     /// retrieve the message format for errorCode
     const char *getFormat(int errorCode) {
-        if (errorCatalog.count(errorCode))
-            return errorCatalog.at(errorCode).second.c_str();
+        auto it = errorCatalog.find(errorCode);
+        if (it != errorCatalog.end())
+            return it->second.second.c_str();
         static std::string msg("errorCatalog message not set for error code ");
         msg += std::to_string(errorCode);
         return msg.c_str();
@@ -17,9 +17,12 @@ limitations under the License.
 #ifndef P4C_LIB_ERROR_REPORTER_H_
 #define P4C_LIB_ERROR_REPORTER_H_
 
+#include <unordered_set>
+
 #include "error_helper.h"
 #include "error_catalog.h"
 #include "exceptions.h"
+#include "hash.h"
 
 /// An action to take when a diagnostic message is triggered.
 enum class DiagnosticAction {
@@ -38,8 +41,27 @@ class ErrorReporter final {
  private:
     std::ostream* outputstream;
 
+    /// An error or warning issued at a valid source location; locations
+    /// are compared by their start.
+    struct ReportedError {
+        int         errorCode;
+        unsigned    line;
+        unsigned    column;
+        ReportedError(int errorCode, const Util::SourceInfo &source)
+            : errorCode(errorCode),
+              line(source.getStart().getLineNumber()),
+              column(source.getStart().getColumnNumber()) {}
+        bool operator==(const ReportedError &other) const {
+            return errorCode == other.errorCode && line == other.line &&
+                   column == other.column; }
+        struct Hash {
+            size_t operator()(const ReportedError &e) const
+            { return Util::Hash::fnv1a(e); }
+        };
+    };
+
     /// Track errors or warnings that have already been issued for a particular source location
-    std::set<std::pair<int, const Util::SourceInfo>> errorTracker;
+    std::unordered_set<ReportedError, ReportedError::Hash> errorTracker;
 
     /// Output the message and flush the stream
     void emit_message(cstring message) {
@@ -50,12 +72,33 @@ class ErrorReporter final {
     /// Check whether an error has already been reported, by keeping track of error type
     /// and source info.
     /// If the error has been reported, return true. Otherwise, insert add the error to the
-    /// list of seen errors, and return false.
+    /// list of seen errors, and return false.  Errors without a source location are
+    /// never recorded, so each of them is reported.
     bool error_reported(int err, const Util::SourceInfo source) {
+        if (!source.isValid())
+            return false;
         auto p = errorTracker.emplace(err, source);
         return !p.second;  // if insertion took place, then we have not seen the error.
     }
 
+    /// The action for a diagnostic from the catalog; avoids converting its
+    /// name to a cstring when no action was overridden.
+    DiagnosticAction catalog_action(const char *name, DiagnosticAction defaultAction) {
+        if (diagnosticActions.empty() &&
+            (defaultAction != DiagnosticAction::Warn ||
+             defaultWarningDiagnosticAction == DiagnosticAction::Warn))
+            return defaultAction;
+        return getDiagnosticAction(name, defaultAction);
+    }
+
+    /// The format of a diagnostic from the catalog: the catalog format
+    /// followed by the format given at the call site.
+    std::string catalog_format(int errorCode, const char *format) {
+        std::string fmt(get_format(errorCode));
+        if (!fmt.empty()) fmt += " ";
+        return fmt += format;
+    }
+
     /// retrieve the format from the error catalog
     const char *get_format(int errorCode) {
         return ErrorCatalog::getCatalog().getFormat(errorCode);
@@ -94,17 +137,12 @@ class ErrorReporter final {
               typename... Args>
     void diagnose(DiagnosticAction action, const int errorCode, const char *format, const T *node,
                   Args... args) {
-        if (!error_reported(errorCode, node->getSourceInfo())) {
-            std::string fmt = std::string(get_format(errorCode));
-            if (!fmt.empty()) fmt += std::string(" ") + format;
-            else              fmt += format;
-            const char *name = get_error_name(errorCode);
-            auto da = getDiagnosticAction(name, action);
-            if (name)
-                diagnose(da, name, fmt.c_str(), node, args...);
-            else
-                diagnose(action, nullptr, fmt.c_str(), node, std::forward<Args>(args)...);
-        }
+        // Suppressed diagnostics are neither tracked nor formatted.
+        const char *name = get_error_name(errorCode);
+        auto da = catalog_action(name, action);
+        if (da == DiagnosticAction::Ignore || error_reported(errorCode, node->getSourceInfo()))
+            return;
+        diagnose(da, name, catalog_format(errorCode, format).c_str(), node, args...);
     }
 
     template <class T,
@@ -118,15 +156,11 @@ class ErrorReporter final {
 
     template <typename... Args>
     void diagnose(DiagnosticAction action, const int errorCode, const char *format, Args... args) {
-        std::string fmt = std::string(get_format(errorCode));
-        if (!fmt.empty()) fmt += std::string(" ") + format;
-        else              fmt += format;
         const char *name = get_error_name(errorCode);
-        auto da = getDiagnosticAction(name, action);
-        if (name)
-            diagnose(da, name, fmt.c_str(), args...);
-        else
-            diagnose(action, nullptr, fmt.c_str(), std::forward<Args>(args)...);
+        auto da = catalog_action(name, action);
+        if (da == DiagnosticAction::Ignore)
+            return;
+        diagnose(da, name, catalog_format(errorCode, format).c_str(), args...);
     }
 
     /// The sink of all the diagnostic functions. Here the error gets printed
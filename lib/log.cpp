@@ -279,6 +279,29 @@ void addInvalidateCallback(void (*fn)(void)) {
     invalidateCallbacks.push_back(fn);
 }
 
+// Allocated on first use, as caches may be looked up before the static
+// objects of this file are initialized.
+static std::vector<FileLogLevelCache *> *fileLogLevelCaches = nullptr;
+
+void resetFileLogLevelCaches() {
+    for (auto cache : *fileLogLevelCaches)
+        cache->level = -1;
+}
+
+int FileLogLevelCache::lookup() {
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    if (!registered) {
+        if (!fileLogLevelCaches) {
+            fileLogLevelCaches = new std::vector<FileLogLevelCache *>;
+            addInvalidateCallback(resetFileLogLevelCaches); }
+        fileLogLevelCaches->push_back(this);
+        registered = true; }
+    return level = fileLogLevel(file);
+}
+
 }  // namespace Detail
 
 void addDebugSpec(const char* spec) {
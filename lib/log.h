@@ -60,6 +60,26 @@ class OutputLogPrefix {
 };
 
 void addInvalidateCallback(void (*)(void));
+
+// The log level of one file, looked up once and kept in a static object
+// of that file until the debug specs or the verbosity change.  Used on
+// hot paths such as IR tracing, where even the cached fileLogLevel()
+// lookup is too expensive.
+class FileLogLevelCache {
+    const char* file;
+    int level;  // -1 if not looked up yet
+    bool registered;
+    friend void resetFileLogLevelCaches();
+    int lookup();
+
+ public:
+    constexpr explicit FileLogLevelCache(const char* file)
+        : file(file), level(-1), registered(false) {}
+    bool isAtLeast(int l) {
+        if (maximumLogLevel < l)
+            return false;
+        return (level >= 0 ? level : lookup()) >= l; }
+};
 }  // namespace Detail
 
 inline std::ostream &endl(std::ostream &out) {
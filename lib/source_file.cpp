@@ -57,8 +57,8 @@ cstring SourceInfo::toDebugString() const {
 //////////////////////////////////////////////////////////////////////////////////////////
 
 InputSources::InputSources() : sealed(false) {
-    mapLine(nullptr, 1);  // the first line read will be line 1 of stdin
-    contents.push_back("");
+    // the first line read will be line 1 of stdin
+    line_file_map.emplace(0, SourceFileLine(nullptr, 1));
 }
 
 void InputSources::addComment(SourceInfo srcInfo, bool singleLine, cstring body) {
@@ -78,8 +78,8 @@ void InputSources::seal() {
 }
 
 unsigned InputSources::lineCount() const {
-    int size = contents.size();
-    if (contents.back().isNullOrEmpty()) {
+    int size = contents.size() + 1;
+    if (lastLine.empty()) {
         // do not count the last line if it is empty.
         size -= 1;
         if (size < 0)
@@ -98,15 +98,16 @@ void InputSources::appendToLastLine(StringRef text) {
         if (c == '\n')
             BUG("Text contains newlines");
     }
-    contents.back() += text.toString();
+    lastLine.append(text.p, text.len);
 }
 
 // Append a newline and start a new line
 void InputSources::appendNewline(StringRef newline) {
     if (sealed)
         BUG("Appending to sealed InputSources");
-    contents.back() += newline.toString();
-    contents.push_back("");  // start a new line
+    lastLine.append(newline.p, newline.len);
+    contents.push_back(lastLine);
+    lastLine.clear();  // start a new line
 }
 
 void InputSources::appendText(const char* text) {
@@ -149,6 +150,8 @@ cstring InputSources::getLine(unsigned lineNumber) const {
         // don't throw: this code may be called by exceptions
         // reporting on elements that have no source position
     }
+    if (lineNumber == contents.size() + 1)
+        return lastLine;
     return contents.at(lineNumber - 1);
 }
 
@@ -181,12 +184,12 @@ SourceFileLine InputSources::getSourceLine(unsigned line) const {
 }
 
 unsigned InputSources::getCurrentLineNumber() const {
-    return contents.size();
+    return contents.size() + 1;
 }
 
 SourcePosition InputSources::getCurrentPosition() const {
     unsigned line = getCurrentLineNumber();
-    unsigned column = contents.back().size();
+    unsigned column = lastLine.size();
     return SourcePosition(line, column);
 }
 
@@ -269,6 +272,7 @@ cstring InputSources::toDebugString() const {
     std::stringstream builder;
     for (auto line : contents)
         builder << line;
+    builder << lastLine;
     builder << "---------------" << std::endl;
     for (auto lf : line_file_map)
         builder << lf.first << ": " << lf.second.toString() << std::endl;
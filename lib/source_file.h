@@ -21,6 +21,7 @@ limitations under the License.
 #ifndef P4C_LIB_SOURCE_FILE_H_
 #define P4C_LIB_SOURCE_FILE_H_
 
+#include <string>
 #include <vector>
 
 #include "gtest/gtest_prod.h"
@@ -338,8 +339,11 @@ class InputSources final {
 
     std::map<unsigned, SourceFileLine> line_file_map;
 
-    /// Each line also stores the end-of-line character(s)
+    /// Each line also stores the end-of-line character(s).  Only complete
+    /// lines are stored here; the line being read by the lexer is kept in
+    /// 'lastLine', so that it is not interned again for each token.
     std::vector<cstring> contents;
+    std::string lastLine;
     /// The commends found in the file.
     std::vector<Comment*> comments;
 };
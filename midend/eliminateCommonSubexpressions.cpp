@@ -0,0 +1,289 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <unordered_map>
+
+#include "eliminateCommonSubexpressions.h"
+#include "expr_uses.h"
+
+namespace P4 {
+
+namespace {
+
+/// True for header.isValid(); the validity of a header union is
+/// computed from all its headers, so it is not treated as simple.
+/// Types are read from the expressions: the expressions rewritten by
+/// an earlier elimination are not in the type map.
+bool isHeaderValid(const IR::MethodCallExpression* mce) {
+    auto member = mce->method->to<IR::Member>();
+    if (member == nullptr || member->member != IR::Type_Header::isValid ||
+        !mce->arguments->empty())
+        return false;
+    return member->expr->type->is<IR::Type_Header>();
+}
+
+/// Structural hash of an expression: equivalent expressions have the
+/// same hash.
+class ExpressionHash : public Inspector {
+    size_t result = 0;
+
+    void combine(size_t value)
+    { result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2); }
+    bool preorder(const IR::Type*) override { return false; }
+    bool preorder(const IR::Node* node) override {
+        combine(std::hash<cstring>()(node->node_type_name()));
+        if (auto constant = node->to<IR::Constant>())
+            combine(std::hash<std::string>()(constant->value.get_str()));
+        else if (auto literal = node->to<IR::BoolLiteral>())
+            combine(literal->value);
+        else if (auto path = node->to<IR::Path>())
+            combine(std::hash<cstring>()(path->name.name));
+        else if (auto member = node->to<IR::Member>())
+            combine(std::hash<cstring>()(member->member.name));
+        return true;
+    }
+
+ public:
+    explicit ExpressionHash(const IR::Expression* expression) {
+        visitDagOnce = false;
+        expression->apply(*this);
+    }
+    size_t get() const { return result; }
+};
+
+/// Number of operations BMv2-like targets evaluate for an expression,
+/// and whether the expression can be evaluated fewer times than it
+/// appears without changing the program.
+class ExpressionCost : public Inspector {
+    bool preorder(const IR::Type*) override { return false; }
+    bool preorder(const IR::Expression*) override { pure = false; return false; }
+    bool preorder(const IR::PathExpression*) override { return false; }
+    bool preorder(const IR::Constant*) override { return false; }
+    bool preorder(const IR::BoolLiteral*) override { return false; }
+    bool preorder(const IR::TypeNameExpression*) override { return false; }
+    bool preorder(const IR::Member*) override { return true; }
+    bool preorder(const IR::ArrayIndex*) override { return true; }
+    bool preorder(const IR::Operation_Unary*) override { operations++; return true; }
+    bool preorder(const IR::Operation_Binary*) override { operations++; return true; }
+    bool preorder(const IR::Operation_Ternary*) override { operations++; return true; }
+    bool preorder(const IR::MethodCallExpression* mce) override {
+        // isValid() reads the validity bit of the header
+        if (isHeaderValid(mce))
+            operations++;
+        else
+            pure = false;
+        return false;
+    }
+
+ public:
+    bool     pure = true;
+    unsigned operations = 0;
+
+    explicit ExpressionCost(const IR::Expression* expression) {
+        visitDagOnce = false;
+        expression->apply(*this);
+    }
+};
+
+/// Collects the subexpressions which could be computed in a temporary.
+class FindCandidates : public Inspector {
+    bool preorder(const IR::Type*) override { return false; }
+    bool preorder(const IR::Expression* expression) override {
+        bool operation = false;
+        if (expression->is<IR::Member>() || expression->is<IR::ArrayIndex>())
+            operation = false;
+        else if (expression->is<IR::Operation_Unary>() ||
+                 expression->is<IR::Operation_Binary>() ||
+                 expression->is<IR::Operation_Ternary>())
+            operation = true;
+        else if (auto mce = expression->to<IR::MethodCallExpression>())
+            operation = isHeaderValid(mce);
+        if (operation) {
+            auto type = expression->type;
+            if (type->is<IR::Type_Bits>() || type->is<IR::Type_Boolean>())
+                candidates.push_back(expression);
+        }
+        return true;
+    }
+
+ public:
+    std::vector<const IR::Expression*> candidates;
+
+    explicit FindCandidates(const IR::Expression* expression) {
+        visitDagOnce = false;
+        expression->apply(*this);
+    }
+};
+
+/// Replaces all the expressions equivalent to 'expression' with 'replacement'.
+class ReplaceExpression : public Transform {
+    const IR::Expression* expression;
+    const IR::Expression* replacement;
+
+ public:
+    ReplaceExpression(const IR::Expression* expression, const IR::Expression* replacement)
+            : expression(expression), replacement(replacement)
+    { visitDagOnce = false; deleteUnchangedClones = true; }
+    const IR::Node* preorder(IR::Expression* e) override {
+        if (!e->equiv(*expression))
+            return e;
+        prune();
+        return replacement;
+    }
+};
+
+/// The variable written by an assignment, or nullptr if it cannot be
+/// determined.
+const IR::PathExpression* lvalueBase(const IR::Expression* expression) {
+    while (true) {
+        if (auto member = expression->to<IR::Member>())
+            expression = member->expr;
+        else if (auto index = expression->to<IR::ArrayIndex>())
+            expression = index->left;
+        else if (auto slice = expression->to<IR::Slice>())
+            expression = slice->e0;
+        else
+            break;
+    }
+    return expression->to<IR::PathExpression>();
+}
+
+}  // namespace
+
+bool DoEliminateCommonSubexpressions::eliminateOne(
+    std::vector<const IR::AssignmentStatement*>& sequence,
+    IR::IndexedVector<IR::StatOrDecl>& declarations) {
+    struct Candidate {
+        const IR::Expression* expression;
+        unsigned operations;
+        size_t   first;
+        size_t   last;
+        unsigned count;
+    };
+    std::vector<Candidate> candidates;
+    // Candidates which are not killed, by hash
+    std::unordered_multimap<size_t, size_t> live;
+
+    for (size_t i = 0; i < sequence.size(); i++) {
+        auto statement = sequence.at(i);
+        FindCandidates find(statement->right);
+        for (auto e : find.candidates) {
+            size_t hash = ExpressionHash(e).get();
+            bool found = false;
+            auto range = live.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                auto& c = candidates.at(it->second);
+                if (c.expression->equiv(*e)) {
+                    c.count++;
+                    c.last = i;
+                    found = true;
+                    break;
+                }
+            }
+            if (found)
+                continue;
+            ExpressionCost cost(e);
+            if (!cost.pure)
+                continue;
+            live.emplace(hash, candidates.size());
+            candidates.push_back({ e, cost.operations, i, i, 1 });
+        }
+
+        // The assignment happens after the right-hand side is evaluated.
+        auto base = lvalueBase(statement->left);
+        for (auto it = live.begin(); it != live.end();) {
+            auto& c = candidates.at(it->second);
+            if (base == nullptr || exprUses(c.expression, base->path->name)) {
+                it = live.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Pick the candidate saving the most operations: evaluating it
+    // once costs an additional assignment.
+    const Candidate* best = nullptr;
+    int bestSaving = 0;
+    for (auto& c : candidates) {
+        int saving = static_cast<int>((c.count - 1) * c.operations) - 1;
+        if (saving > bestSaving ||
+            (saving == bestSaving && best != nullptr && c.operations > best->operations)) {
+            best = &c;
+            bestSaving = saving;
+        }
+    }
+    if (best == nullptr)
+        return false;
+
+    auto type = best->expression->type;
+    auto tmp = refMap->newName("cse");
+    LOG2("Computing " << best->expression << " in " << tmp << " saves " <<
+         bestSaving << " operations");
+    declarations.push_back(new IR::Declaration_Variable(tmp, type, nullptr));
+
+    std::vector<const IR::AssignmentStatement*> result;
+    for (size_t i = 0; i < sequence.size(); i++) {
+        auto statement = sequence.at(i);
+        if (i == best->first)
+            result.push_back(new IR::AssignmentStatement(
+                best->expression->srcInfo, new IR::PathExpression(type, new IR::Path(tmp)),
+                best->expression));
+        if (i >= best->first && i <= best->last) {
+            ReplaceExpression replace(best->expression,
+                                      new IR::PathExpression(type, new IR::Path(tmp)));
+            auto right = statement->right->apply(replace)->to<IR::Expression>();
+            statement = new IR::AssignmentStatement(statement->srcInfo, statement->left, right);
+        }
+        result.push_back(statement);
+    }
+    sequence = result;
+    return true;
+}
+
+void DoEliminateCommonSubexpressions::flush(
+    std::vector<const IR::AssignmentStatement*>& sequence,
+    IR::IndexedVector<IR::StatOrDecl>& result) {
+    if (sequence.size() > 1)
+        while (eliminateOne(sequence, result)) {}
+    for (auto s : sequence)
+        result.push_back(s);
+    sequence.clear();
+}
+
+const IR::Node* DoEliminateCommonSubexpressions::postorder(IR::BlockStatement* block) {
+    IR::IndexedVector<IR::StatOrDecl> result;
+    std::vector<const IR::AssignmentStatement*> sequence;
+    for (auto c : block->components) {
+        if (auto assign = c->to<IR::AssignmentStatement>()) {
+            sequence.push_back(assign);
+            continue;
+        }
+        auto decl = c->to<IR::Declaration_Variable>();
+        if (decl != nullptr && decl->initializer == nullptr) {
+            // does not end the sequence
+            result.push_back(c);
+            continue;
+        }
+        flush(sequence, result);
+        result.push_back(c);
+    }
+    flush(sequence, result);
+    block->components = result;
+    return block;
+}
+
+}  // namespace P4
@@ -0,0 +1,96 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _MIDEND_ELIMINATECOMMONSUBEXPRESSIONS_H_
+#define _MIDEND_ELIMINATECOMMONSUBEXPRESSIONS_H_
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+
+namespace P4 {
+
+/**
+ * Computes repeated pure subexpressions once into temporaries.
+ *
+ * \code{.cpp}
+ *  a = (h.x + h.y) * 2;
+ *  b = (h.x + h.y) * 2 + c;
+ * \endcode
+ *
+ * is transformed to
+ *
+ * \code{.cpp}
+ *  bit<32> cse_0;
+ *  cse_0 = (h.x + h.y) * 2;
+ *  a = cse_0;
+ *  b = cse_0 + c;
+ * \endcode
+ *
+ * Only sequences of assignments in a block statement are considered:
+ * a subexpression is reused until one of the variables it reads is
+ * assigned.  Method calls and all other statements end a sequence.
+ * Expressions are compared by structural hashing followed by 'equiv'.
+ * A temporary is only introduced if the operations saved outweigh
+ * the added assignment.  Parsers are not changed.
+ *
+ * Assignments are used rather than conditions because on targets
+ * such as BMv2 a sequence of assignments in a control becomes a single
+ * action, so the temporary costs one primitive, while a temporary
+ * used by an 'if' condition would need an extra action.
+ *
+ * @pre Requires expression types be stored inline in the expression
+ * (obtained by running Typechecking(updateProgram = true)).
+ * @post New variables are declared in the block where they are used;
+ * MoveDeclarations may be needed afterwards.
+ */
+class DoEliminateCommonSubexpressions : public Transform {
+    ReferenceMap* refMap;
+    TypeMap*      typeMap;
+
+    /// Eliminate the most profitable common subexpression from a
+    /// sequence of assignments.  Returns false if there is none.
+    bool eliminateOne(std::vector<const IR::AssignmentStatement*>& sequence,
+                      IR::IndexedVector<IR::StatOrDecl>& declarations);
+    void flush(std::vector<const IR::AssignmentStatement*>& sequence,
+               IR::IndexedVector<IR::StatOrDecl>& result);
+
+ public:
+    DoEliminateCommonSubexpressions(ReferenceMap* refMap, TypeMap* typeMap)
+            : refMap(refMap), typeMap(typeMap) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap);
+        setName("DoEliminateCommonSubexpressions");
+    }
+    const IR::Node* preorder(IR::P4Parser* parser) override
+    { prune(); return parser; }
+    const IR::Node* postorder(IR::BlockStatement* block) override;
+};
+
+class EliminateCommonSubexpressions : public PassManager {
+ public:
+    EliminateCommonSubexpressions(ReferenceMap* refMap, TypeMap* typeMap,
+                                  TypeChecking* typeChecking = nullptr) {
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap, true);
+        passes.push_back(typeChecking);
+        passes.push_back(new DoEliminateCommonSubexpressions(refMap, typeMap));
+        setName("EliminateCommonSubexpressions");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_ELIMINATECOMMONSUBEXPRESSIONS_H_ */
@@ -150,15 +150,26 @@ class DoLocalCopyPropagation::RewriteTableKeys : public Transform {
 void DoLocalCopyPropagation::flow_merge(Visitor &a_) {
     auto &a = dynamic_cast<DoLocalCopyPropagation &>(a_);
     BUG_CHECK(working == a.working, "inconsitent DoLocalCopyPropagation state on merge");
+    need_key_rewrite |= a.need_key_rewrite;
+    if (available.shares(a.available))
+        return;
+    // only copy the map if the merge changes something
+    std::vector<cstring> drop, live;
     for (auto &var : available) {
         if (auto merge = ::getref(a.available, var.first)) {
-            if (merge->val != var.second.val)
-                var.second.val = nullptr;
-            if (merge->live)
-                var.second.live = true;
-        } else {
-            var.second.val = nullptr; } }
-    need_key_rewrite |= a.need_key_rewrite;
+            if (merge->val != var.second.val && var.second.val)
+                drop.push_back(var.first);
+            if (merge->live && !var.second.live)
+                live.push_back(var.first);
+        } else if (var.second.val) {
+            drop.push_back(var.first); } }
+    if (drop.empty() && live.empty())
+        return;
+    auto &avail = available.modify();
+    for (auto name : drop)
+        avail.at(name).val = nullptr;
+    for (auto name : live)
+        avail.at(name).live = true;
 }
 
 /// test to see if names denote overlapping locations
@@ -173,36 +184,49 @@ bool DoLocalCopyPropagation::name_overlap(cstring name1, cstring name2) {
 
 void DoLocalCopyPropagation::forOverlapAvail(cstring name,
                                              std::function<void(cstring, VarInfo *)> fn) {
+    std::vector<cstring> overlap;
     for (const char *pfx = name.c_str(); *pfx; pfx += strspn(pfx, ".[")) {
         pfx += strcspn(pfx, ".[");
         auto it = available.find(name.before(pfx));
         if (it != available.end())
-            fn(it->first, &it->second); }
+            overlap.push_back(it->first); }
     for (auto it = available.upper_bound(name); it != available.end(); ++it) {
         if (!it->first.startsWith(name) || !strchr(".[", it->first.get(name.size())))
             break;
-        fn(it->first, &it->second); }
+        overlap.push_back(it->first); }
+    if (overlap.empty())
+        return;
+    auto &avail = available.modify();
+    for (auto var : overlap)
+        fn(var, &avail.at(var));
 }
 
 void DoLocalCopyPropagation::dropValuesUsing(cstring name) {
     LOG6("dropValuesUsing(" << name << ")");
+    std::vector<cstring> drop;
     for (auto &var : available) {
         LOG7("  checking " << var.first << " = " << var.second.val);
         if (name_overlap(var.first, name)) {
             LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << "as " << name <<
                  " is being assigned to");
-            var.second.val = nullptr;
+            if (var.second.val)
+                drop.push_back(var.first);
         } else if (var.second.val && exprUses(var.second.val, name)) {
             LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << var.first <<
                  " as it uses " << name);
-            var.second.val = nullptr; } }
+            drop.push_back(var.first); } }
+    if (drop.empty())
+        return;
+    auto &avail = available.modify();
+    for (auto var : drop)
+        avail.at(var).val = nullptr;
 }
 
 void DoLocalCopyPropagation::visit_local_decl(const IR::Declaration_Variable *var) {
     LOG4("Visiting " << var);
     if (available.count(var->name))
         BUG("duplicate var declaration for %s", var->name);
-    auto &local = available[var->name];
+    auto &local = available.modify()[var->name];
     local.local = true;
     if (var->initializer) {
         if (!hasSideEffects(var->initializer)) {
@@ -256,7 +280,8 @@ const IR::Expression *DoLocalCopyPropagation::copyprop_name(cstring name) {
             LOG3("  policy rejects propagation of " << name << ": " << var->val);
         } else {
             LOG4("  using " << name << " with no propagated value"); }
-        var->live = true; }
+        if (!var->live)
+            available.modify().at(name).live = true; }
     forOverlapAvail(name, [name](cstring, VarInfo *var) {
         LOG4("  using part of " << name);
         var->live = true; });
@@ -330,7 +355,7 @@ IR::AssignmentStatement *DoLocalCopyPropagation::postorder(IR::AssignmentStateme
                  * may make things worse rather than better */
                 return as; }
             LOG3("  saving value for " << dest << ": " << as->right);
-            available[dest].val = as->right;
+            available.modify()[dest].val = as->right;
         } else {
             LOG3("Can't copyprop " << as->right << " due to side effects"); }
     } else {
@@ -442,14 +467,21 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
             // maybe should have annotations if it does
             return mc; } }
     LOG3("unknown method call " << mc->method << " clears all nonlocal saved values");
+    std::vector<cstring> nonlocals;
     for (auto &var : available) {
         if (!var.second.local) {
             LOG7("    may access non-local " << var.first);
-            var.second.val = nullptr;
-            var.second.live = true;
+            if (var.second.val || !var.second.live)
+                nonlocals.push_back(var.first);
             if (inferForFunc) {
                 inferForFunc->reads.insert(var.first);
                 inferForFunc->writes.insert(var.first); } } }
+    if (!nonlocals.empty()) {
+        auto &avail = available.modify();
+        for (auto name : nonlocals) {
+            auto &var = avail.at(name);
+            var.val = nullptr;
+            var.live = true; } }
     return mc;
 }
 
@@ -17,6 +17,7 @@ limitations under the License.
 #define MIDEND_LOCAL_COPYPROP_H_
 
 #include "ir/ir.h"
+#include "lib/cow_map.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 
@@ -65,7 +66,9 @@ class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteCont
     struct FuncInfo {
         std::set<cstring>       reads, writes;
     };
-    std::map<cstring, VarInfo>          available;
+    /// Copy-on-write, as the visitor is cloned at each branch and most
+    /// branches leave it unchanged.
+    cow_map<cstring, VarInfo>           available;
     std::map<cstring, TableInfo>        &tables;
     std::map<cstring, FuncInfo>         &actions;
     std::map<cstring, FuncInfo>         &methods;
@@ -92,11 +92,40 @@ class ParserSymbolicInterpreter {
             stateName == IR::ParserState::reject)
             return nullptr;
         auto state = structure->get(stateName);
-        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values->clone());
+        if (auto seen = findEquivalent(predecessor, stateName, values)) {
+            LOG1("State " << stateName << " already reached as " << seen->name);
+            return nullptr;
+        }
+        // The value map is never mutated once it is the 'after' map of
+        // a state, so all successors can share it; evaluateState copies
+        // it before executing any statement.
+        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values);
         synthesizedParser->add(pi);
         return pi;
     }
 
+    // A state previously reached with the same values produces the same
+    // successors, so it does not need to be evaluated again.  States on
+    // the path to 'predecessor' are not reused, since checkLoops needs
+    // to see the cycle.
+    const ParserStateInfo* findEquivalent(const ParserStateInfo* predecessor,
+                                          cstring stateName, const ValueMap* values) const {
+        for (auto si : *synthesizedParser->get(stateName)) {
+            if (si->before != values && !si->before->equals(values))
+                continue;
+            bool onPath = false;
+            for (auto crt = predecessor; crt != nullptr; crt = crt->predecessor) {
+                if (crt == si) {
+                    onPath = true;
+                    break;
+                }
+            }
+            if (!onPath)
+                return si;
+        }
+        return nullptr;
+    }
+
     static void stateChain(const ParserStateInfo* state, std::stringstream& stream) {
         if (state->predecessor != nullptr) {
             stateChain(state->predecessor, stream);
@@ -295,6 +324,10 @@ class ParserSymbolicInterpreter {
 
     std::vector<ParserStateInfo*>* evaluateState(ParserStateInfo* state) {
         LOG1("Analyzing " << state->state);
+        if (state->state->components.empty()) {
+            state->after = state->before;
+            return evaluateSelect(state);
+        }
         auto valueMap = state->before->clone();
         for (auto s : state->state->components) {
             bool success = executeStatement(state, s, valueMap);
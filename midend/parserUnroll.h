@@ -61,6 +61,8 @@ class ParserInfo {
         }
         return vec;
     }
+    const std::vector<ParserStateInfo*>* get(cstring origState) const
+    { return ::get(states, origState); }
     void add(ParserStateInfo* si) {
         cstring origState = si->state->name.name;
         auto vec = get(origState);
@@ -0,0 +1,289 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/optional.hpp>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "backends/bmv2/common/controlFlowGraph.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+#include "helpers.h"
+#include "ir/ir.h"
+
+using namespace P4;
+
+namespace Test {
+
+namespace {
+
+/// Builds entry -> if1(known) and if1 --value--> if2(cond), with
+/// if2 --true--> "taken" and if2 --false--> "skipped"; the other branch
+/// of if1 goes to the exit.  Returns the name of the node that the edge
+/// from if1 reaches after optimization, or "if" when if2 is still there.
+cstring cfgImpliedBranch(const IR::Expression* known, bool value,
+                         const IR::Expression* cond) {
+    BMV2::CFG cfg;
+    cfg.setEntry(cfg.makeNode("entry"));
+    cfg.exitPoint = cfg.makeNode("");
+    auto taken = cfg.makeNode("taken");
+    auto skipped = cfg.makeNode("skipped");
+    auto if1 = cfg.makeNode(new IR::IfStatement(known, new IR::EmptyStatement(), nullptr));
+    auto if2 = cfg.makeNode(new IR::IfStatement(cond, new IR::EmptyStatement(), nullptr));
+    cfg.entryPoint->successors.emplace(new BMV2::CFG::Edge(if1));
+    if1->successors.emplace(new BMV2::CFG::Edge(if2, value));
+    if1->successors.emplace(new BMV2::CFG::Edge(cfg.exitPoint, !value));
+    if2->successors.emplace(new BMV2::CFG::Edge(taken, true));
+    if2->successors.emplace(new BMV2::CFG::Edge(skipped, false));
+    taken->successors.emplace(new BMV2::CFG::Edge(cfg.exitPoint));
+    skipped->successors.emplace(new BMV2::CFG::Edge(cfg.exitPoint));
+
+    cfg.optimize();
+    for (auto e : if1->successors.edges) {
+        if (e->getBool() != value)
+            continue;
+        if (e->endpoint->is<BMV2::CFG::IfNode>())
+            return "if";
+        return e->endpoint->name;
+    }
+    return nullptr;
+}
+
+const IR::Expression* cfgVar(cstring name) {
+    return new IR::PathExpression(name);
+}
+
+const IR::Expression* cfgEqu(const IR::Expression* e, int value) {
+    return new IR::Equ(e, new IR::Constant(value));
+}
+
+const IR::Expression* cfgNeq(const IR::Expression* e, int value) {
+    return new IR::Neq(e, new IR::Constant(value));
+}
+
+const IR::Expression* cfgNot(const IR::Expression* e) {
+    return new IR::LNot(e);
+}
+
+boost::optional<FrontendTestCase>
+createCFGTestCase(const std::string& ingressLocals, const std::string& ingressApply) {
+    std::string source = P4_SOURCE(P4Headers::V1MODEL, R"(
+header H { bit<8> f; }
+struct Headers { H h; }
+struct Metadata { }
+
+parser parse(packet_in packet, out Headers headers, inout Metadata meta,
+             inout standard_metadata_t sm) {
+    state start {
+        packet.extract(headers.h);
+        transition accept;
+    }
+}
+
+control verifyChecksum(inout Headers headers, inout Metadata meta) { apply { } }
+control ingress(inout Headers headers, inout Metadata meta,
+                inout standard_metadata_t sm) {
+    action nop() { }
+    action set(bit<8> v) { headers.h.f = v; }
+    table t1 { key = { headers.h.f : exact; } actions = { set; nop; } default_action = nop; }
+    table t2 { key = { headers.h.f : exact; } actions = { set; nop; } default_action = nop; }
+%INGRESS_LOCALS%
+    apply {
+%INGRESS_APPLY%
+    }
+}
+
+control egress(inout Headers headers, inout Metadata meta,
+               inout standard_metadata_t sm) { apply { } }
+
+control computeChecksum(inout Headers headers, inout Metadata meta) { apply { } }
+
+control deparse(packet_out packet, in Headers headers) {
+    apply { packet.emit(headers.h); }
+}
+
+V1Switch(parse(), verifyChecksum(), ingress(), egress(),
+    computeChecksum(), deparse()) main;
+    )");
+
+    boost::replace_first(source, "%INGRESS_LOCALS%", ingressLocals);
+    boost::replace_first(source, "%INGRESS_APPLY%", ingressApply);
+    return FrontendTestCase::create(source);
+}
+
+/// Builds and optimizes the CFG of the ingress control.
+BMV2::CFG* optimizedIngressCFG(const IR::P4Program* program) {
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    program->apply(TypeChecking(&refMap, &typeMap));
+    for (auto decl : program->objects) {
+        auto control = decl->to<IR::P4Control>();
+        if (control == nullptr || control->name != "ingress")
+            continue;
+        auto cfg = new BMV2::CFG();
+        cfg->build(control, &refMap, &typeMap);
+        if (!cfg->checkImplementable())
+            return nullptr;
+        cfg->optimize();
+        return cfg;
+    }
+    return nullptr;
+}
+
+BMV2::CFG::TableNode* cfgTable(BMV2::CFG* cfg, cstring name) {
+    for (auto n : cfg->allNodes) {
+        auto tn = n->to<BMV2::CFG::TableNode>();
+        if (tn != nullptr && tn->table->name == name)
+            return tn;
+    }
+    return nullptr;
+}
+
+std::set<BMV2::CFG::Node*> cfgReachable(BMV2::CFG* cfg) {
+    std::set<BMV2::CFG::Node*> reachable;
+    std::vector<BMV2::CFG::Node*> work = { cfg->entryPoint };
+    while (!work.empty()) {
+        auto n = work.back();
+        work.pop_back();
+        if (!reachable.emplace(n).second)
+            continue;
+        for (auto e : n->successors.edges)
+            work.push_back(e->endpoint);
+    }
+    return reachable;
+}
+
+}  // namespace
+
+class BMV2ControlFlowGraph : public P4CTest { };
+
+TEST_F(BMV2ControlFlowGraph, ImpliedByNegation) {
+    auto x = cfgVar("x");
+    EXPECT_EQ("taken", cfgImpliedBranch(cfgNot(cfgEqu(x, 1)), false, cfgEqu(x, 1)));
+    EXPECT_EQ("skipped", cfgImpliedBranch(cfgEqu(x, 1), true, cfgNot(cfgEqu(x, 1))));
+    EXPECT_EQ("taken", cfgImpliedBranch(cfgNot(cfgNot(cfgEqu(x, 1))), true, cfgEqu(x, 1)));
+    EXPECT_EQ("skipped", cfgImpliedBranch(cfgNot(cfgEqu(x, 1)), true,
+                                          cfgNot(cfgNot(cfgEqu(x, 1)))));
+}
+
+TEST_F(BMV2ControlFlowGraph, ImpliedByComparisons) {
+    auto x = cfgVar("x");
+    // x == 1 holds
+    EXPECT_EQ("skipped", cfgImpliedBranch(cfgEqu(x, 1), true, cfgEqu(x, 2)));
+    EXPECT_EQ("taken", cfgImpliedBranch(cfgEqu(x, 1), true, cfgNeq(x, 2)));
+    EXPECT_EQ("taken", cfgImpliedBranch(cfgNeq(x, 1), false, cfgEqu(x, 1)));
+    EXPECT_EQ("skipped", cfgImpliedBranch(cfgNeq(x, 1), false, cfgEqu(x, 2)));
+    EXPECT_EQ("skipped", cfgImpliedBranch(new IR::Equ(new IR::Constant(1), x), true,
+                                          cfgEqu(x, 2)));
+    // x != 1 holds
+    EXPECT_EQ("skipped", cfgImpliedBranch(cfgNeq(x, 1), true, cfgEqu(x, 1)));
+    EXPECT_EQ("taken", cfgImpliedBranch(cfgEqu(x, 1), false, cfgNeq(x, 1)));
+    // nothing is known about x == 2 when x != 1
+    EXPECT_EQ("if", cfgImpliedBranch(cfgNeq(x, 1), true, cfgEqu(x, 2)));
+    EXPECT_EQ("if", cfgImpliedBranch(cfgEqu(x, 1), false, cfgNeq(x, 2)));
+    // different expressions
+    EXPECT_EQ("if", cfgImpliedBranch(cfgEqu(x, 1), true, cfgEqu(cfgVar("y"), 2)));
+}
+
+TEST_F(BMV2ControlFlowGraph, ConstantDefaultActionResolvesSwitch) {
+    auto test = createCFGTestCase(P4_SOURCE(R"(
+        table k { actions = { nop; } const default_action = nop; }
+    )"), P4_SOURCE(R"(
+        switch (k.apply().action_run) {
+            nop: { t1.apply(); }
+            default: { t2.apply(); }
+        }
+    )"));
+    ASSERT_TRUE(test);
+    auto cfg = optimizedIngressCFG(test->program);
+    ASSERT_TRUE(cfg != nullptr);
+
+    auto k = cfgTable(cfg, "k");
+    auto t1 = cfgTable(cfg, "t1");
+    auto t2 = cfgTable(cfg, "t2");
+    ASSERT_TRUE(k && t1 && t2);
+    ASSERT_EQ(1u, k->successors.size());
+    auto edge = *k->successors.edges.begin();
+    EXPECT_TRUE(edge->isUnconditional());
+    EXPECT_EQ(t1, edge->endpoint);
+
+    // t2 can no longer be reached, but it is still emitted since the
+    // control-plane can refer to it.
+    auto reachable = cfgReachable(cfg);
+    EXPECT_EQ(0u, reachable.count(t2));
+    EXPECT_EQ(1u, cfg->allNodes.count(t2));
+    EXPECT_EQ(1u, t2->successors.size());
+}
+
+TEST_F(BMV2ControlFlowGraph, DefaultActionKeepsSwitch) {
+    auto test = createCFGTestCase(P4_SOURCE(R"(
+        table k { actions = { nop; } default_action = nop; }
+    )"), P4_SOURCE(R"(
+        switch (k.apply().action_run) {
+            nop: { t1.apply(); }
+            default: { t2.apply(); }
+        }
+    )"));
+    ASSERT_TRUE(test);
+    auto cfg = optimizedIngressCFG(test->program);
+    ASSERT_TRUE(cfg != nullptr);
+
+    // the control-plane can change the default action
+    auto k = cfgTable(cfg, "k");
+    ASSERT_TRUE(k != nullptr);
+    std::set<cstring> labels;
+    for (auto e : k->successors.edges) {
+        if (!e->isUnconditional() && !e->isBool())
+            labels.emplace(e->label);
+    }
+    EXPECT_EQ(std::set<cstring>({ "nop", "default" }), labels);
+    auto reachable = cfgReachable(cfg);
+    EXPECT_EQ(1u, reachable.count(cfgTable(cfg, "t1")));
+    EXPECT_EQ(1u, reachable.count(cfgTable(cfg, "t2")));
+}
+
+TEST_F(BMV2ControlFlowGraph, UnreachableTableKeepsConditionals) {
+    auto test = createCFGTestCase(P4_SOURCE(R"(
+        table k { actions = { nop; } const default_action = nop; }
+    )"), P4_SOURCE(R"(
+        switch (k.apply().action_run) {
+            nop: { }
+            default: {
+                t2.apply();
+                if (headers.h.f == 1) { t1.apply(); }
+            }
+        }
+    )"));
+    ASSERT_TRUE(test);
+    auto cfg = optimizedIngressCFG(test->program);
+    ASSERT_TRUE(cfg != nullptr);
+
+    // The conditional after t2 is only reached through t2, but the
+    // table still refers to it as its next node.
+    auto t2 = cfgTable(cfg, "t2");
+    ASSERT_TRUE(t2 != nullptr);
+    EXPECT_EQ(0u, cfgReachable(cfg).count(t2));
+    ASSERT_EQ(1u, t2->successors.size());
+    auto next = (*t2->successors.edges.begin())->endpoint;
+    EXPECT_TRUE(next->is<BMV2::CFG::IfNode>());
+    EXPECT_EQ(1u, cfg->allNodes.count(next));
+}
+
+}  // namespace Test
@@ -0,0 +1,283 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "backends/bmv2/common/helpers.h"
+#include "backends/bmv2/common/parser.h"
+#include "helpers.h"
+#include "ir/json_parser.h"
+
+namespace Test {
+
+namespace {
+
+BMV2::SelectCase selectValue(int value, cstring next, int mask = -1) {
+    BMV2::SelectCase c;
+    c.is_vset = false;
+    c.value = value;
+    c.mask = mask;
+    c.next = IR::ID(next);
+    return c;
+}
+
+BMV2::SelectCase selectDefault(cstring next) {
+    return selectValue(0, next, 0);
+}
+
+BMV2::SelectCase selectVset(cstring name, cstring next) {
+    BMV2::SelectCase c;
+    c.is_vset = true;
+    c.vset_name = name;
+    c.value = 0;
+    c.mask = 0;
+    c.next = IR::ID(next);
+    return c;
+}
+
+/// Compacts the cases of a select on an 8-bit key and describes the
+/// result, e.g. "0x10&&&0xf0->a; pvs->b; default->c".
+std::string compactSelect(std::vector<BMV2::SelectCase> cases) {
+    BMV2::compactSelectCases(cases, 0xff);
+    std::string result;
+    for (auto& c : cases) {
+        if (!result.empty())
+            result += "; ";
+        if (c.is_vset)
+            result += c.vset_name.c_str();
+        else if (c.isDefault())
+            result += "default";
+        else if (c.mask == -1 || c.mask == 0xff)
+            result += BMV2::stringRepr(c.value).c_str();
+        else
+            result += std::string(BMV2::stringRepr(c.value).c_str()) + "&&&" +
+                      BMV2::stringRepr(c.mask).c_str();
+        result += std::string("->") + c.next.name.c_str();
+    }
+    return result;
+}
+
+const JsonData* parserJsonField(const JsonData* json, const char* label) {
+    auto object = json->to<JsonObject>();
+    if (object == nullptr || object->find(label) == object->end())
+        return nullptr;
+    return object->at(label);
+}
+
+/// Strings are returned as they are, and arrays are joined with dots,
+/// so that field references read as "ip.proto".
+std::string parserJsonText(const JsonData* json) {
+    if (json == nullptr || json->is<JsonNull>())
+        return "null";
+    if (auto s = json->to<JsonString>())
+        return *s;
+    if (auto n = json->to<JsonNumber>())
+        return n->val.get_str();
+    std::string result;
+    if (auto v = json->to<JsonVector>()) {
+        for (auto e : *v) {
+            if (!result.empty())
+                result += ".";
+            result += parserJsonText(e);
+        }
+    }
+    return result;
+}
+
+/// Describes each state of the first parser of a BMv2 JSON program,
+/// e.g. "start: extract(h) select(h.f) 0x01->next default->null".
+std::vector<std::string> describeParseStates(const JsonData* program) {
+    std::vector<std::string> result;
+    auto parsers = parserJsonField(program, "parsers")->to<JsonVector>();
+    auto states = parserJsonField(parsers->at(0), "parse_states")->to<JsonVector>();
+    for (auto state : *states) {
+        std::string desc = parserJsonText(parserJsonField(state, "name")) + ":";
+        for (auto op : *parserJsonField(state, "parser_ops")->to<JsonVector>()) {
+            desc += " " + parserJsonText(parserJsonField(op, "op")) + "(";
+            auto parameters = parserJsonField(op, "parameters")->to<JsonVector>();
+            for (size_t i = 0; i < parameters->size(); i++)
+                desc += (i ? ", " : "") + parserJsonText(parserJsonField(parameters->at(i),
+                                                                         "value"));
+            desc += ")";
+        }
+        auto key = parserJsonField(state, "transition_key");
+        if (key != nullptr && !key->to<JsonVector>()->empty()) {
+            desc += " select(";
+            auto fields = key->to<JsonVector>();
+            for (size_t i = 0; i < fields->size(); i++)
+                desc += (i ? ", " : "") + parserJsonText(parserJsonField(fields->at(i),
+                                                                         "value"));
+            desc += ")";
+        }
+        for (auto t : *parserJsonField(state, "transitions")->to<JsonVector>())
+            desc += " " + parserJsonText(parserJsonField(t, "value")) + "->" +
+                    parserJsonText(parserJsonField(t, "next_state"));
+        result.push_back(desc);
+    }
+    return result;
+}
+
+}  // namespace
+
+class BMV2Parser : public P4CTest { };
+
+TEST_F(BMV2Parser, ShadowedCases) {
+    EXPECT_EQ("0x10&&&0xf0->a; default->b",
+              compactSelect({ selectValue(0x10, "a", 0xf0), selectValue(0x12, "c"),
+                              selectDefault("b"), selectValue(0x20, "c") }));
+    // masks are normalized to the width of the key
+    EXPECT_EQ("0x1->a; default->b",
+              compactSelect({ selectValue(0x1, "a", 0xfff), selectValue(0x1, "c"),
+                              selectDefault("b") }));
+}
+
+TEST_F(BMV2Parser, DefaultTargetCases) {
+    EXPECT_EQ("0x10&&&0xf0->b; default->a",
+              compactSelect({ selectValue(0x10, "b", 0xf0), selectValue(0x22, "a"),
+                              selectDefault("a") }));
+    // 0x12 would match the case between it and the default
+    EXPECT_EQ("0x12->a; 0x10&&&0xf0->b; default->a",
+              compactSelect({ selectValue(0x12, "a"), selectValue(0x10, "b", 0xf0),
+                              selectDefault("a") }));
+    // 0x10 is matched by an earlier case, which does not change
+    EXPECT_EQ("0x10&&&0xf0->b; default->a",
+              compactSelect({ selectValue(0x10, "b", 0xf0), selectValue(0x00, "a", 0x0f),
+                              selectDefault("a") }));
+}
+
+TEST_F(BMV2Parser, JoinedCases) {
+    EXPECT_EQ("0x4&&&0xfe->a; default->b",
+              compactSelect({ selectValue(0x4, "a"), selectValue(0x5, "a"),
+                              selectDefault("b") }));
+    EXPECT_EQ("0x20&&&0xe0->a; 0x41->b",
+              compactSelect({ selectValue(0x20, "a", 0xf0), selectValue(0x41, "b"),
+                              selectValue(0x30, "a", 0xf0) }));
+    // 0x31 would be matched by the joined case
+    EXPECT_EQ("0x20&&&0xf0->a; 0x31->b; 0x30&&&0xf0->a",
+              compactSelect({ selectValue(0x20, "a", 0xf0), selectValue(0x31, "b"),
+                              selectValue(0x30, "a", 0xf0) }));
+    // different masks or destinations
+    EXPECT_EQ("0x4->a; 0x5&&&0xfd->a; 0x6->b",
+              compactSelect({ selectValue(0x4, "a"), selectValue(0x5, "a", 0xfd),
+                              selectValue(0x6, "b") }));
+}
+
+TEST_F(BMV2Parser, ValueSetCases) {
+    // the value set may contain 0x1
+    EXPECT_EQ("0x1->a; pvs->b; default->a",
+              compactSelect({ selectValue(0x1, "a"), selectVset("pvs", "b"),
+                              selectDefault("a") }));
+    EXPECT_EQ("0x4->a; pvs->b; 0x5->a; default->c",
+              compactSelect({ selectValue(0x4, "a"), selectVset("pvs", "b"),
+                              selectValue(0x5, "a"), selectDefault("c") }));
+    // a value set does not shadow the cases after it
+    EXPECT_EQ("pvs->b; 0x4->c; default->a",
+              compactSelect({ selectVset("pvs", "b"), selectValue(0x4, "c"),
+                              selectDefault("a") }));
+    EXPECT_EQ("pvs->b; default->a",
+              compactSelect({ selectVset("pvs", "b"), selectValue(0x4, "a"),
+                              selectDefault("a") }));
+}
+
+TEST_F(BMV2Parser, NegativeCases) {
+    // cases on signed fields are left as they are
+    EXPECT_EQ("-0x1->a; -0x1->b; 0x4->a; 0x5->a; default->a",
+              compactSelect({ selectValue(-1, "a"), selectValue(-1, "b"),
+                              selectValue(0x4, "a"), selectValue(0x5, "a"),
+                              selectDefault("a") }));
+}
+
+TEST_F(BMV2Parser, MergedStates) {
+    std::ofstream source("bmv2_parser_merge.p4");
+    source << R"(
+#include <core.p4>
+#include <v1model.p4>
+
+header Ethernet_h { bit<48> dst; bit<48> src; bit<16> type; }
+header Ip_h { bit<8> proto; bit<8> ttl; }
+header Option_h { bit<8> kind; }
+header Port_h { bit<16> port; }
+header Trailer_h { bit<8> value; }
+struct Headers { Ethernet_h eth; Ip_h ip; Option_h option; Port_h tcp; Port_h udp;
+                 Trailer_h trailer; }
+struct Metadata { }
+
+parser parse(packet_in packet, out Headers headers, inout Metadata meta,
+             inout standard_metadata_t sm) {
+    state start {
+        packet.extract(headers.eth);
+        transition select(headers.eth.type) { 0x0800: ip; default: accept; }
+    }
+    // The only predecessor of ip has a select
+    state ip {
+        packet.extract(headers.ip);
+        transition option;
+    }
+    // The annotation stops the front-end from merging option into ip
+    @name(".option") state option {
+        packet.extract(headers.option);
+        transition select(headers.ip.proto) { 6: tcp; 17: udp; default: accept; }
+    }
+    state tcp {
+        packet.extract(headers.tcp);
+        transition trailer;
+    }
+    state udp {
+        packet.extract(headers.udp);
+        transition trailer;
+    }
+    state trailer {
+        packet.extract(headers.trailer);
+        transition accept;
+    }
+}
+
+control verifyChecksum(inout Headers headers, inout Metadata meta) { apply { } }
+control ingress(inout Headers headers, inout Metadata meta,
+                inout standard_metadata_t sm) { apply { } }
+control egress(inout Headers headers, inout Metadata meta,
+               inout standard_metadata_t sm) { apply { } }
+control computeChecksum(inout Headers headers, inout Metadata meta) { apply { } }
+control deparse(packet_out packet, in Headers headers) { apply { packet.emit(headers.eth); } }
+
+V1Switch(parse(), verifyChecksum(), ingress(), egress(),
+    computeChecksum(), deparse()) main;
+)";
+    source.close();
+    int exitCode = system("./p4c-bm2-ss -o bmv2_parser_merge.json bmv2_parser_merge.p4");
+    ASSERT_FALSE(exitCode);
+
+    std::ifstream output("bmv2_parser_merge.json");
+    JsonData* program = nullptr;
+    output >> program;
+    ASSERT_TRUE(program != nullptr);
+    // option is emitted as part of ip; the states with two predecessors
+    // or whose predecessor has a select are kept.
+    EXPECT_EQ(std::vector<std::string>({
+        "start: extract(eth) select(eth.type) 0x0800->ip default->null",
+        "ip: extract(ip) extract(option) select(ip.proto) 0x06->tcp 0x11->udp default->null",
+        "tcp: extract(tcp) default->trailer",
+        "udp: extract(udp) default->trailer",
+        "trailer: extract(trailer) default->null",
+    }), describeParseStates(program));
+}
+
+}  // namespace Test
@@ -0,0 +1,227 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "backends/bmv2/common/JsonObjects.h"
+#include "backends/bmv2/common/helpers.h"
+#include "backends/bmv2/common/primitiveOptimizer.h"
+#include "helpers.h"
+#include "lib/json.h"
+
+namespace Test {
+
+namespace {
+
+Util::JsonObject* primField(cstring header, cstring field) {
+    auto result = new Util::JsonObject();
+    result->emplace("type", "field");
+    auto value = new Util::JsonArray();
+    value->append(header);
+    value->append(field);
+    result->emplace("value", value);
+    return result;
+}
+
+Util::JsonObject* primConstant(int value) {
+    auto result = new Util::JsonObject();
+    result->emplace("type", "hexstr");
+    result->emplace("value", BMV2::stringRepr(value));
+    return result;
+}
+
+Util::JsonObject* primHeader(cstring header) {
+    auto result = new Util::JsonObject();
+    result->emplace("type", "header");
+    result->emplace("value", header);
+    return result;
+}
+
+Util::JsonObject* primAdd(Util::IJson* left, Util::IJson* right) {
+    auto op = new Util::JsonObject();
+    op->emplace("op", "+");
+    op->emplace("left", left);
+    op->emplace("right", right);
+    auto result = new Util::JsonObject();
+    result->emplace("type", "expression");
+    result->emplace("value", op);
+    return result;
+}
+
+void primAppend(Util::JsonArray* body, cstring op,
+                Util::IJson* first, Util::IJson* second = nullptr) {
+    auto primitive = BMV2::mkPrimitive(op, body);
+    auto parameters = BMV2::mkParameters(primitive);
+    parameters->append(first);
+    if (second != nullptr)
+        parameters->append(second);
+}
+
+/// A compact representation of primitives and their parameters, e.g.
+/// "assign(h1.a, (h1.b + 0x1))".
+std::string primDescribe(const Util::IJson* json, const char* separator = "; ") {
+    if (auto array = json->to<Util::JsonArray>()) {
+        std::string result;
+        for (auto p : *array) {
+            if (!result.empty())
+                result += separator;
+            result += primDescribe(p);
+        }
+        return result;
+    }
+    auto object = json->to<Util::JsonObject>();
+    if (object == nullptr)
+        return json->toString().c_str();
+    auto op = object->get("op");
+    if (op != nullptr && object->get("parameters") != nullptr)
+        return std::string(op->to<Util::JsonValue>()->getString().c_str()) + "(" +
+               primDescribe(object->get("parameters"), ", ") + ")";
+    if (op != nullptr)
+        return "(" + primDescribe(object->get("left")) + " " +
+               op->to<Util::JsonValue>()->getString().c_str() + " " +
+               primDescribe(object->get("right")) + ")";
+    cstring type = object->get("type")->to<Util::JsonValue>()->getString();
+    auto value = object->get("value");
+    if (type == "field") {
+        auto array = value->to<Util::JsonArray>();
+        return std::string(array->at(0)->to<Util::JsonValue>()->getString().c_str()) + "." +
+               array->at(1)->to<Util::JsonValue>()->getString().c_str();
+    }
+    if (type == "expression")
+        return primDescribe(value);
+    return value->to<Util::JsonValue>()->getString().c_str();
+}
+
+}  // namespace
+
+/// Packet headers h1 and h2 and metadata m1 and m2, all with fields a
+/// and b, and the scalars x and tmp.
+class BMV2PrimitiveOptimizer : public P4CTest {
+ protected:
+    BMV2::JsonObjects json;
+    BMV2::PrimitiveOptimizer* optimizer;
+    Util::JsonArray* body = new Util::JsonArray();
+
+    BMV2PrimitiveOptimizer() {
+        for (cstring type : { "hdr_t", "scalars_t" }) {
+            json.add_header_type(type);
+            for (cstring field : type == "hdr_t" ? std::set<cstring>{ "a", "b" }
+                                                 : std::set<cstring>{ "x", "tmp" }) {
+                auto f = new Util::JsonArray();
+                f->append(field);
+                f->append(8);
+                f->append(false);
+                json.add_header_field(type, f);
+            }
+        }
+        json.add_header("hdr_t", "h1");
+        json.add_header("hdr_t", "h2");
+        json.add_metadata("hdr_t", "m1");
+        json.add_metadata("hdr_t", "m2");
+        json.add_metadata("scalars_t", "scalars");
+        optimizer = new BMV2::PrimitiveOptimizer(&json, "scalars");
+    }
+
+    std::string optimize(std::set<cstring> locals = { "tmp" }) {
+        optimizer->optimize(body, locals);
+        return primDescribe(body);
+    }
+};
+
+TEST_F(BMV2PrimitiveOptimizer, DeadAndLiveWrites) {
+    // overwritten before being read
+    primAppend(body, "assign", primField("h1", "a"), primConstant(1));
+    primAppend(body, "assign", primField("h1", "a"), primConstant(2));
+    // self-assignment
+    primAppend(body, "assign", primField("h1", "b"), primField("h1", "b"));
+    // never read again by this action, but other actions may read it
+    primAppend(body, "assign", primField("scalars", "x"), primConstant(3));
+    // only accessed by this action and never read again
+    primAppend(body, "assign", primField("scalars", "tmp"), primConstant(4));
+    EXPECT_EQ("assign(h1.a, 0x2); assign(scalars.x, 0x3)", optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, LiveAtEndOfAction) {
+    // tmp is read before being written, so the value written at the end
+    // is read when the action is executed again.
+    primAppend(body, "assign", primField("h1", "a"), primField("scalars", "tmp"));
+    primAppend(body, "assign", primField("scalars", "tmp"),
+               primAdd(primField("scalars", "tmp"), primConstant(1)));
+    EXPECT_EQ("assign(h1.a, scalars.tmp); assign(scalars.tmp, (scalars.tmp + 0x1))",
+              optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, ForwardCopies) {
+    primAppend(body, "assign", primField("scalars", "tmp"), primField("h1", "a"));
+    primAppend(body, "assign", primField("h2", "a"), primConstant(5));
+    primAppend(body, "assign", primField("h1", "b"),
+               primAdd(primField("scalars", "tmp"), primConstant(1)));
+    EXPECT_EQ("assign(h2.a, 0x5); assign(h1.b, (h1.a + 0x1))", optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, ForwardingBlockedByWrite) {
+    // h1.a changes between the definition of tmp and its use
+    primAppend(body, "assign", primField("scalars", "tmp"), primField("h1", "a"));
+    primAppend(body, "assign", primField("h1", "a"), primConstant(5));
+    primAppend(body, "assign", primField("h1", "b"), primField("scalars", "tmp"));
+    EXPECT_EQ("assign(scalars.tmp, h1.a); assign(h1.a, 0x5); assign(h1.b, scalars.tmp)",
+              optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, MetadataCopies) {
+    primAppend(body, "assign", primField("m1", "a"), primField("m2", "a"));
+    primAppend(body, "assign", primField("m1", "b"), primField("m2", "b"));
+    EXPECT_EQ("assign_header(m1, m2)", optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, PartialMetadataCopy) {
+    primAppend(body, "assign", primField("m1", "a"), primField("m2", "a"));
+    primAppend(body, "assign", primField("m1", "b"), primField("m2", "a"));
+    EXPECT_EQ("assign(m1.a, m2.a); assign(m1.b, m2.a)", optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, HeaderFieldCopies) {
+    // assign_header would also copy the validity of h2
+    primAppend(body, "assign", primField("h1", "a"), primField("h2", "a"));
+    primAppend(body, "assign", primField("h1", "b"), primField("h2", "b"));
+    EXPECT_EQ("assign(h1.a, h2.a); assign(h1.b, h2.b)", optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, ValidityBarriers) {
+    // tmp cannot be forwarded across the removal of h1
+    primAppend(body, "assign", primField("scalars", "tmp"), primField("h1", "a"));
+    primAppend(body, "remove_header", primHeader("h1"));
+    primAppend(body, "assign", primField("h2", "a"), primField("scalars", "tmp"));
+    // add_header depends on the fields written before it
+    primAppend(body, "assign", primField("h2", "b"), primConstant(1));
+    primAppend(body, "add_header", primHeader("h2"));
+    primAppend(body, "assign", primField("h2", "b"), primConstant(2));
+    EXPECT_EQ("assign(scalars.tmp, h1.a); remove_header(h1); assign(h2.a, scalars.tmp); "
+              "assign(h2.b, 0x1); add_header(h2); assign(h2.b, 0x2)", optimize());
+}
+
+TEST_F(BMV2PrimitiveOptimizer, ExternBarrier) {
+    primAppend(body, "assign", primField("scalars", "tmp"), primField("h1", "a"));
+    primAppend(body, "count", primHeader("c"), primConstant(0));
+    primAppend(body, "assign", primField("h1", "b"), primField("scalars", "tmp"));
+    EXPECT_EQ("assign(scalars.tmp, h1.a); count(c, 0x0); assign(h1.b, scalars.tmp)",
+              optimize());
+}
+
+}  // namespace Test
@@ -0,0 +1,72 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "lib/cow_map.h"
+
+namespace Test {
+
+TEST(cow_map, copy_shares) {
+    cow_map<unsigned, unsigned> a;
+    a.modify()[1] = 111;
+    a.modify()[2] = 222;
+
+    cow_map<unsigned, unsigned> b = a;
+    EXPECT_TRUE(a.shares(b));
+    EXPECT_TRUE(a == b);
+    EXPECT_EQ(b.size(), 2U);
+    EXPECT_EQ(b.at(2), 222U);
+}
+
+TEST(cow_map, modify_copy) {
+    cow_map<unsigned, unsigned> a;
+    a.modify()[1] = 111;
+    a.modify()[2] = 222;
+
+    cow_map<unsigned, unsigned> b = a;
+    b.modify()[2] = 2;
+    b.modify()[3] = 333;
+
+    EXPECT_FALSE(a.shares(b));
+    EXPECT_TRUE(a != b);
+    EXPECT_EQ(a.size(), 2U);
+    EXPECT_EQ(a.at(2), 222U);
+    EXPECT_EQ(a.count(3), 0U);
+    EXPECT_EQ(b.size(), 3U);
+    EXPECT_EQ(b.at(2), 2U);
+    EXPECT_EQ(*getref(b, 3), 333U);
+    EXPECT_TRUE(getref(a, 3) == nullptr);
+
+    b.modify()[2] = 222;
+    b.modify().erase(3);
+    EXPECT_FALSE(a.shares(b));
+    EXPECT_TRUE(a == b);
+}
+
+TEST(cow_map, clear) {
+    cow_map<unsigned, unsigned> a;
+    EXPECT_TRUE(a.empty());
+    EXPECT_TRUE(a.begin() == a.end());
+
+    a.modify()[1] = 111;
+    cow_map<unsigned, unsigned> b = a;
+    a.clear();
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(b.size(), 1U);
+    EXPECT_EQ(b.upper_bound(0)->first, 1U);
+}
+
+}  // namespace Test
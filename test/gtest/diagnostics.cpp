@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/optional.hpp>
+#include <sstream>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -266,4 +267,40 @@ TEST_F(Diagnostics, CompilerOptions) {
     }
 }
 
+TEST_F(Diagnostics, ReportedOncePerLocation) {
+    AutoCompileContext autoContext(new GTestContext);
+    auto& reporter = BaseCompileContext::get().errorReporter();
+    std::stringstream output;
+    reporter.setOutputStream(&output);
+
+    Util::InputSources sources;
+    sources.appendText("bit<8> x = 1;\nbit<8> y = 2;\n");
+    auto at = [&sources](unsigned line, unsigned column) {
+        return Util::SourceInfo(&sources, Util::SourcePosition(line, column),
+                                Util::SourcePosition(line, column + 1));
+    };
+    auto first = new IR::Constant(at(1, 11), 1);
+    auto second = new IR::Constant(at(2, 11), 2);
+
+    // A diagnostic is reported once per kind and start position.
+    ::warning(ErrorType::WARN_UNUSED, "%1%", first);
+    ::warning(ErrorType::WARN_UNUSED, "%1%", new IR::Constant(at(1, 11), 3));
+    ::error(ErrorType::ERR_NOT_FOUND, "%1%", first);
+    EXPECT_EQ(1u, ::errorCount());
+    EXPECT_EQ(2u, ::diagnosticCount());
+
+    // Ignored diagnostics are neither counted nor remembered.
+    reporter.setDiagnosticAction("unused", DiagnosticAction::Ignore);
+    ::warning(ErrorType::WARN_UNUSED, "%1%", second);
+    EXPECT_EQ(2u, ::diagnosticCount());
+    reporter.setDiagnosticAction("unused", DiagnosticAction::Warn);
+    ::warning(ErrorType::WARN_UNUSED, "%1%", second);
+    EXPECT_EQ(3u, ::diagnosticCount());
+
+    // Diagnostics on nodes without a source location are all reported.
+    ::warning(ErrorType::WARN_UNUSED, "%1%", new IR::Constant(4));
+    ::warning(ErrorType::WARN_UNUSED, "%1%", new IR::Constant(5));
+    EXPECT_EQ(5u, ::diagnosticCount());
+}
+
 }  // namespace Test
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <sstream>
+
 #include "gtest/gtest.h"
 #include "ir/ir.h"
 #include "helpers.h"
@@ -23,6 +25,9 @@ limitations under the License.
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/typeMap.h"
 #include "midend/convertEnums.h"
+#include "midend/eliminateCommonSubexpressions.h"
+#include "midend/local_copyprop.h"
+#include "midend/parserUnroll.h"
 
 using namespace P4;
 
@@ -39,6 +44,49 @@ class EnumOn32Bits : public ChooseEnumRepresentation {
     }
 };
 
+/// A control with 'locals' variables and if statements nested 'depth'
+/// deep, each branch assigning some of the variables.
+std::string largeControl(unsigned locals, unsigned depth) {
+    std::stringstream src;
+    src << "control c(inout bit<32> x) {\n";
+    for (unsigned i = 0; i < locals; i++)
+        src << "    bit<32> v" << i << ";\n";
+    src << "    apply {\n";
+    for (unsigned i = 0; i < locals; i++)
+        src << "        v" << i << " = x + " << i << ";\n";
+    for (unsigned d = 0; d < depth; d++) {
+        unsigned v = (d * 7) % locals;
+        src << "        if (x == " << d << ") {\n"
+            << "            v" << v << " = v" << (v + 1) % locals << ";\n"
+            << "        } else {\n"
+            << "            x = v" << v << ";\n";
+    }
+    for (unsigned d = 0; d < depth; d++)
+        src << "        }\n";
+    for (unsigned i = 0; i < locals; i++)
+        src << "        x = x + v" << i << ";\n";
+    src << "    }\n}\n";
+    return src.str();
+}
+
+/// Symbolically evaluates the only parser of 'program'.
+const ParserInfo* analyzeParser(const IR::P4Program* program) {
+    auto refMap = new ReferenceMap;
+    auto typeMap = new TypeMap;
+    program = program->apply(TypeChecking(refMap, typeMap));
+    if (program == nullptr || ::errorCount() > 0)
+        return nullptr;
+    const IR::P4Parser* parser = nullptr;
+    forAllMatching<IR::P4Parser>(program, [&](const IR::P4Parser* p) { parser = p; });
+    if (parser == nullptr)
+        return nullptr;
+    auto structure = new ParserStructure;
+    structure->setParser(parser);
+    parser->apply(AnalyzeParser(refMap, structure));
+    structure->analyze(refMap, typeMap, false);
+    return structure->result;
+}
+
 }  // namespace
 
 class P4CMidend : public P4CTest { };
@@ -108,4 +156,226 @@ TEST_F(P4CMidend, getEnumMapping) {
     ASSERT_EQ(enumMap.size(), (unsigned long)1);
 }
 
+// a repeated expression is computed once, until its inputs change
+TEST_F(P4CMidend, eliminateCommonSubexpressions) {
+    std::string program = P4_SOURCE(R"(
+        control c(inout bit<32> x, inout bit<32> y) {
+            bit<32> a;
+            bit<32> b;
+            apply {
+                a = (x + y) * 2;
+                b = (x + y) * 2 + 1;
+                x = a + b;
+                y = (x + y) * 2;
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    PassManager passes = {
+        new P4::EliminateCommonSubexpressions(&refMap, &typeMap)
+    };
+    pgm = pgm->apply(passes);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    unsigned temporaries = 0;
+    unsigned multiplications = 0;
+    forAllMatching<IR::Declaration_Variable>(pgm, [&](const IR::Declaration_Variable* decl) {
+        if (decl->name.name.startsWith("cse"))
+            temporaries++;
+    });
+    forAllMatching<IR::Mul>(pgm, [&](const IR::Mul*) { multiplications++; });
+    EXPECT_EQ(temporaries, 1U);
+    // once for a and b, once more after x has changed
+    EXPECT_EQ(multiplications, 2U);
+}
+
+// the second temporary is found in the expressions rewritten for the first
+TEST_F(P4CMidend, eliminateCommonSubexpressions_overlapping) {
+    std::string program = P4_SOURCE(R"(
+        control c(in bit<32> x, in bit<32> y,
+                  out bit<32> a, out bit<32> b, out bit<32> d, out bit<32> e) {
+            apply {
+                a = (x + y) * 2 + 1;
+                b = (x + y) * 2 + 1;
+                d = (x + y) + 5;
+                e = (x + y) ^ 7;
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    PassManager passes = {
+        new P4::EliminateCommonSubexpressions(&refMap, &typeMap)
+    };
+    pgm = pgm->apply(passes);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    unsigned temporaries = 0;
+    unsigned additions = 0;
+    forAllMatching<IR::Declaration_Variable>(pgm, [&](const IR::Declaration_Variable* decl) {
+        if (decl->name.name.startsWith("cse"))
+            temporaries++;
+    });
+    forAllMatching<IR::Add>(pgm, [&](const IR::Add*) { additions++; });
+    EXPECT_EQ(temporaries, 2U);
+    // x + y once, then + 1 and + 5
+    EXPECT_EQ(additions, 3U);
+}
+
+// isValid() is an operation, so repeating it is worth a temporary
+TEST_F(P4CMidend, eliminateCommonSubexpressions_isValid) {
+    std::string program = P4_SOURCE(R"(
+        header H { bit<8> f; }
+        control c(inout H h, out bool a, out bool b, out bool d) {
+            apply {
+                a = h.isValid();
+                b = h.isValid();
+                d = h.isValid();
+                h.f = 1;
+                a = h.isValid();
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    PassManager passes = {
+        new P4::EliminateCommonSubexpressions(&refMap, &typeMap)
+    };
+    pgm = pgm->apply(passes);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    unsigned temporaries = 0;
+    unsigned calls = 0;
+    forAllMatching<IR::Declaration_Variable>(pgm, [&](const IR::Declaration_Variable* decl) {
+        if (decl->name.name.startsWith("cse"))
+            temporaries++;
+    });
+    forAllMatching<IR::MethodCallExpression>(pgm, [&](const IR::MethodCallExpression*) {
+        calls++;
+    });
+    EXPECT_EQ(temporaries, 1U);
+    // once for a, b and d, once more after h has changed
+    EXPECT_EQ(calls, 2U);
+}
+
+// copy propagation in a control with many locals and deeply nested
+// branches; the flow state is cloned at every branch.
+TEST_F(P4CMidend, localCopyPropagation_large_control) {
+    std::string program = P4_SOURCE(largeControl(300, 100).c_str());
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    PassManager passes = {
+        new P4::LocalCopyPropagation(&refMap, &typeMap)
+    };
+    pgm = pgm->apply(passes);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    auto isLocal = [](const IR::Expression* e) {
+        auto path = e->to<IR::PathExpression>();
+        return path != nullptr && path->path->name.name.startsWith("v");
+    };
+    // every local is still read at the end of the control
+    unsigned locals = 0;
+    forAllMatching<IR::Declaration_Variable>(pgm, [&](const IR::Declaration_Variable*) {
+        locals++;
+    });
+    EXPECT_EQ(locals, 300U);
+
+    // Before x is first assigned, v0 = v1 becomes v0 = x + 1.
+    const IR::IfStatement* outer = nullptr;
+    forAllMatching<IR::IfStatement>(pgm, [&](const IR::IfStatement* s) {
+        if (outer == nullptr)
+            outer = s;
+    });
+    ASSERT_TRUE(outer != nullptr);
+    const IR::Expression* propagated = nullptr;
+    forAllMatching<IR::AssignmentStatement>(outer->ifTrue, [&](const IR::AssignmentStatement* as) {
+        propagated = as->right;
+    });
+    ASSERT_TRUE(propagated != nullptr && propagated->is<IR::Add>());
+    EXPECT_FALSE(isLocal(propagated->to<IR::Add>()->left));
+
+    // Once x is a copy of a local, the conditions below read that local:
+    // x == d becomes v(d - 1) == d from the third level on.
+    unsigned conditions = 0;
+    forAllMatching<IR::Equ>(pgm, [&](const IR::Equ* e) {
+        if (isLocal(e->left))
+            conditions++;
+    });
+    EXPECT_EQ(conditions, 98U);
+}
+
+// c is reached from a and b with equal values, so it is evaluated once
+TEST_F(P4CMidend, parserUnroll_memoized) {
+    std::string program = P4_SOURCE(P4Headers::CORE, R"(
+        header H { bit<8> f; }
+        struct S { H h1; H h2; }
+        parser p(packet_in pkt, out S s) {
+            bit<8> tmp;
+            state start {
+                pkt.extract(s.h1);
+                transition select(s.h1.f) { 0: a; default: b; }
+            }
+            state a {
+                tmp = 1;
+                transition c;
+            }
+            state b {
+                tmp = 1;
+                transition c;
+            }
+            state c {
+                pkt.extract(s.h2);
+                transition accept;
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    auto info = analyzeParser(pgm);
+    ASSERT_TRUE(info != nullptr && ::errorCount() == 0);
+    ASSERT_TRUE(info->get("a") != nullptr && info->get("b") != nullptr);
+    EXPECT_EQ(info->get("a")->size(), 1U);
+    EXPECT_EQ(info->get("b")->size(), 1U);
+    ASSERT_TRUE(info->get("c") != nullptr);
+    EXPECT_EQ(info->get("c")->size(), 1U);
+}
+
+// start is reached again with the values it was first evaluated with;
+// as it is on the current path it is not memoized and the cycle is reported
+TEST_F(P4CMidend, parserUnroll_cycle) {
+    std::string program = P4_SOURCE(P4Headers::CORE, R"(
+        parser p(packet_in pkt, in bit<8> x) {
+            state start {
+                transition a;
+            }
+            state a {
+                transition select(x) { 0: start; default: accept; }
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    auto info = analyzeParser(pgm);
+    ASSERT_TRUE(info != nullptr);
+    EXPECT_EQ(::errorCount(), 1U);
+    ASSERT_TRUE(info->get("start") != nullptr);
+    EXPECT_EQ(info->get("start")->size(), 2U);
+}
+
 }  // namespace Test
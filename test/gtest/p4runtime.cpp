@@ -18,9 +18,13 @@ limitations under the License.
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/optional.hpp>
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/util/json_util.h>
 #include <google/protobuf/util/message_differencer.h>
 
+#include <fstream>
 #include <iterator>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -32,6 +36,7 @@ limitations under the License.
 
 #include "control-plane/p4RuntimeSerializer.h"
 #include "control-plane/typeSpecConverter.h"
+#include "frontends/common/options.h"
 #include "frontends/common/parseInput.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/parseAnnotations.h"
@@ -150,6 +155,56 @@ const p4configv1::Digest* findDigest(const P4::P4RuntimeAPI& analysis,
     return findP4InfoObject(digests.begin(), digests.end(), name);
 }
 
+/// @return a P4Runtime API with the tables ingress.t1 and ingress.t2, and
+/// @t1Entries entries of t1 followed by @t2Entries entries of t2. The
+/// priority of each entry is its index in the WriteRequest.
+P4::P4RuntimeAPI createEntriesTestCase(int t1Entries, int t2Entries) {
+    auto p4Info = new p4configv1::P4Info;
+    auto entries = new p4v1::WriteRequest;
+    const char* names[] = { "ingress.t1", "ingress.t2" };
+    const int counts[] = { t1Entries, t2Entries };
+    for (int t = 0; t < 2; t++) {
+        auto table = p4Info->add_tables();
+        table->mutable_preamble()->set_id((P4Ids::TABLE << 24) | (t + 1));
+        table->mutable_preamble()->set_name(names[t]);
+        for (int i = 0; i < counts[t]; i++) {
+            auto update = entries->add_updates();
+            update->set_type(p4v1::Update::INSERT);
+            auto entry = update->mutable_entity()->mutable_table_entry();
+            entry->set_table_id(table->preamble().id());
+            entry->set_priority(entries->updates_size());
+        }
+    }
+    return P4::P4RuntimeAPI{p4Info, entries};
+}
+
+/// @return the updates of @entries from @first to @first + @count.
+p4v1::WriteRequest sliceEntries(const p4v1::WriteRequest& entries, int first, int count) {
+    p4v1::WriteRequest slice;
+    for (int i = first; i < first + count; i++)
+        *slice.add_updates() = entries.updates(i);
+    return slice;
+}
+
+/// @return the WriteRequest read from @file, in the format given by its suffix.
+p4v1::WriteRequest readEntriesFile(const std::string& file) {
+    p4v1::WriteRequest entries;
+    std::ifstream in(file, std::ios::binary);
+    EXPECT_TRUE(in.good()) << "Couldn't open " << file;
+    std::stringstream contents;
+    contents << in.rdbuf();
+    bool success;
+    if (file.size() >= 5 && file.substr(file.size() - 5) == ".json")
+        success = google::protobuf::util::JsonStringToMessage(contents.str(), &entries) ==
+                  google::protobuf::util::Status::OK;
+    else if (file.size() >= 4 && file.substr(file.size() - 4) == ".txt")
+        success = google::protobuf::TextFormat::ParseFromString(contents.str(), &entries);
+    else
+        success = entries.ParseFromString(contents.str());
+    EXPECT_TRUE(success) << "Couldn't parse " << file;
+    return entries;
+}
+
 }  // namespace
 
 class P4Runtime : public P4CTest { };
@@ -969,6 +1024,256 @@ TEST_F(P4Runtime, StaticTableEntries) {
     }
 }
 
+TEST_F(P4Runtime, StaticTableEntriesSink) {
+    auto frontendTestCase = FrontendTestCase::create(P4_SOURCE(P4Headers::V1MODEL, R"(
+        header Header { bit<8> hfA; bit<16> hfB; }
+        struct Headers { Header h; }
+        struct Metadata { }
+
+        parser parse(packet_in p, out Headers h, inout Metadata m,
+                     inout standard_metadata_t sm) {
+            state start { transition accept; } }
+        control verifyChecksum(inout Headers h, inout Metadata m) { apply { } }
+        control egress(inout Headers h, inout Metadata m,
+                        inout standard_metadata_t sm) { apply { } }
+        control computeChecksum(inout Headers h, inout Metadata m) { apply { } }
+        control deparse(packet_out p, in Headers h) { apply { } }
+
+        control ingress(inout Headers h, inout Metadata m,
+                        inout standard_metadata_t sm) {
+            action a(bit<9> x) { sm.egress_spec = x; }
+
+            table t1 {
+                key = { h.h.hfA : exact; }
+                actions = { a; }
+                const entries = {
+                    (0x01) : a(1);
+                    (0x02) : a(2);
+                }
+            }
+            table t2 {
+                key = { h.h.hfB : exact; }
+                actions = { a; }
+                const entries = {
+                    (0x0003) : a(3);
+                }
+            }
+            apply { t1.apply(); t2.apply(); }
+        }
+        V1Switch(parse(), verifyChecksum(), ingress(), egress(),
+                 computeChecksum(), deparse()) main;
+    )"));
+    ASSERT_TRUE(frontendTestCase);
+
+    struct CollectingSink : public P4::P4RuntimeEntriesSink {
+        std::vector<std::pair<cstring, p4v1::Update>> updates;
+        void add(cstring tableName, const p4v1::Update& update) override {
+            updates.emplace_back(tableName, update);
+        }
+    } sink;
+
+    auto inMemory = P4::generateP4Runtime(frontendTestCase->program, defaultArch);
+    auto streamed = P4::P4RuntimeSerializer::get()->generateP4Runtime(
+        frontendTestCase->program, defaultArch, &sink);
+    EXPECT_EQ(0u, ::diagnosticCount());
+
+    // The sink receives the entries instead of the WriteRequest, in the same order.
+    EXPECT_EQ(0, streamed.entries->updates_size());
+    ASSERT_EQ(3, inMemory.entries->updates_size());
+    ASSERT_EQ(3u, sink.updates.size());
+    for (int i = 0; i < 3; i++)
+        EXPECT_TRUE(MessageDifferencer::Equals(inMemory.entries->updates(i),
+                                               sink.updates.at(i).second));
+    EXPECT_EQ(cstring("ingress.t1"), sink.updates.at(0).first);
+    EXPECT_EQ(cstring("ingress.t1"), sink.updates.at(1).first);
+    EXPECT_EQ(cstring("ingress.t2"), sink.updates.at(2).first);
+}
+
+// The entries files are written in chunks of 1024 updates; t1 spans three.
+TEST_F(P4Runtime, StaticTableEntriesFiles) {
+    auto api = createEntriesTestCase(2500, 3);
+    CompilerOptions options;
+    options.p4RuntimeEntriesFiles = "entries_files.bin,entries_files.txt,entries_files.json";
+    P4::P4RuntimeSerializer::get()->serializeP4RuntimeIfRequired(api, options);
+    EXPECT_EQ(0u, ::diagnosticCount());
+
+    for (auto file : { "entries_files.bin", "entries_files.txt", "entries_files.json" }) {
+        auto entries = readEntriesFile(file);
+        EXPECT_EQ(2503, entries.updates_size()) << file;
+        EXPECT_TRUE(MessageDifferencer::Equals(*api.entries, entries)) << file;
+    }
+}
+
+// With --p4runtime-entries-per-table, each table has its own files, named
+// by inserting the table name before the suffix.
+TEST_F(P4Runtime, StaticTableEntriesFilesPerTable) {
+    auto api = createEntriesTestCase(1500, 3);
+    CompilerOptions options;
+    options.p4RuntimeEntriesFiles = "entries_shard.bin,entries_shard.txt,entries_shard.json";
+    options.p4RuntimeEntriesPerTable = true;
+    P4::P4RuntimeSerializer::get()->serializeP4RuntimeIfRequired(api, options);
+    EXPECT_EQ(0u, ::diagnosticCount());
+
+    auto t1Entries = sliceEntries(*api.entries, 0, 1500);
+    auto t2Entries = sliceEntries(*api.entries, 1500, 3);
+    for (auto suffix : { ".bin", ".txt", ".json" }) {
+        auto t1 = readEntriesFile(std::string("entries_shard.ingress.t1") + suffix);
+        auto t2 = readEntriesFile(std::string("entries_shard.ingress.t2") + suffix);
+        EXPECT_EQ(1500, t1.updates_size()) << suffix;
+        EXPECT_TRUE(MessageDifferencer::Equals(t1Entries, t1)) << suffix;
+        EXPECT_EQ(3, t2.updates_size()) << suffix;
+        EXPECT_TRUE(MessageDifferencer::Equals(t2Entries, t2)) << suffix;
+    }
+}
+
+// A JSON file without entries is an empty WriteRequest.
+TEST_F(P4Runtime, StaticTableEntriesFilesEmpty) {
+    auto api = createEntriesTestCase(0, 0);
+    CompilerOptions options;
+    options.p4RuntimeEntriesFiles = "entries_empty.json";
+    P4::P4RuntimeSerializer::get()->serializeP4RuntimeIfRequired(api, options);
+    EXPECT_EQ(0u, ::diagnosticCount());
+    EXPECT_EQ(0, readEntriesFile("entries_empty.json").updates_size());
+}
+
+TEST_F(P4Runtime, PreviousP4InfoIds) {
+    auto frontendTestCase = FrontendTestCase::create(P4_SOURCE(P4Headers::V1MODEL, R"(
+        header Header { bit<8> hfA; }
+        struct Headers { Header h; }
+        struct Metadata { }
+
+        parser parse(packet_in p, out Headers h, inout Metadata m,
+                     inout standard_metadata_t sm) {
+            state start { transition accept; } }
+        control verifyChecksum(inout Headers h, inout Metadata m) { apply { } }
+        control egress(inout Headers h, inout Metadata m,
+                        inout standard_metadata_t sm) { apply { } }
+        control computeChecksum(inout Headers h, inout Metadata m) { apply { } }
+        control deparse(packet_out p, in Headers h) { apply { } }
+
+        control ingress(inout Headers h, inout Metadata m,
+                        inout standard_metadata_t sm) {
+            action a() { sm.egress_spec = 0; }
+            table t1 { key = { h.h.hfA : exact; } actions = { a; } }
+            table t2 { key = { h.h.hfA : exact; } actions = { a; } }
+            apply { t1.apply(); t2.apply(); }
+        }
+        V1Switch(parse(), verifyChecksum(), ingress(), egress(),
+                 computeChecksum(), deparse()) main;
+    )"));
+    ASSERT_TRUE(frontendTestCase);
+
+    auto original = P4::generateP4Runtime(frontendTestCase->program, defaultArch);
+    auto t1 = findTable(original, "ingress.t1");
+    auto t2 = findTable(original, "ingress.t2");
+    ASSERT_TRUE(t1 != nullptr);
+    ASSERT_TRUE(t2 != nullptr);
+
+    // A previous build where t1 had another id, t2 did not exist and a
+    // removed table had the id which t2 gets when there is no previous build.
+    p4configv1::P4Info previous(*original.p4Info);
+    const uint32_t t1PreviousId = (P4Ids::TABLE << 24) | 0x1234;
+    ASSERT_NE(t1PreviousId, t1->preamble().id());
+    ASSERT_NE(t1PreviousId, t2->preamble().id());
+    for (auto& table : *previous.mutable_tables()) {
+        if (table.preamble().name() == "ingress.t1") {
+            table.mutable_preamble()->set_id(t1PreviousId);
+        } else if (table.preamble().name() == "ingress.t2") {
+            table.mutable_preamble()->set_name("ingress.removed");
+        }
+    }
+
+    auto updated = P4::P4RuntimeSerializer::get()->generateP4Runtime(
+        frontendTestCase->program, defaultArch, nullptr, &previous);
+    EXPECT_EQ(0u, ::diagnosticCount());
+    auto t1Updated = findTable(updated, "ingress.t1");
+    auto t2Updated = findTable(updated, "ingress.t2");
+    ASSERT_TRUE(t1Updated != nullptr);
+    ASSERT_TRUE(t2Updated != nullptr);
+    EXPECT_EQ(t1PreviousId, t1Updated->preamble().id());
+    // The id of the removed table is not given to a new one.
+    EXPECT_NE(t2->preamble().id(), t2Updated->preamble().id());
+    EXPECT_NE(t1PreviousId, t2Updated->preamble().id());
+    // Objects which did not change keep their id.
+    auto action = findAction(original, "ingress.a");
+    auto actionUpdated = findAction(updated, "ingress.a");
+    ASSERT_TRUE(action != nullptr);
+    ASSERT_TRUE(actionUpdated != nullptr);
+    EXPECT_EQ(action->preamble().id(), actionUpdated->preamble().id());
+}
+
+// The P4Info changes list the objects which were added, removed or changed.
+TEST_F(P4Runtime, P4InfoDiff) {
+    auto frontendTestCase = FrontendTestCase::create(P4_SOURCE(P4Headers::V1MODEL, R"(
+        header Header { bit<8> hfA; }
+        struct Headers { Header h; }
+        struct Metadata { }
+
+        parser parse(packet_in p, out Headers h, inout Metadata m,
+                     inout standard_metadata_t sm) {
+            state start { transition accept; } }
+        control verifyChecksum(inout Headers h, inout Metadata m) { apply { } }
+        control egress(inout Headers h, inout Metadata m,
+                        inout standard_metadata_t sm) { apply { } }
+        control computeChecksum(inout Headers h, inout Metadata m) { apply { } }
+        control deparse(packet_out p, in Headers h) { apply { } }
+
+        control ingress(inout Headers h, inout Metadata m,
+                        inout standard_metadata_t sm) {
+            action a() { sm.egress_spec = 0; }
+            table t1 { key = { h.h.hfA : exact; } actions = { a; } }
+            table t2 { key = { h.h.hfA : exact; } actions = { a; } }
+            apply { t1.apply(); t2.apply(); }
+        }
+        V1Switch(parse(), verifyChecksum(), ingress(), egress(),
+                 computeChecksum(), deparse()) main;
+    )"));
+    ASSERT_TRUE(frontendTestCase);
+
+    // A previous build where t1 had another size and t2 did not exist,
+    // but a removed table did.
+    auto original = P4::generateP4Runtime(frontendTestCase->program, defaultArch);
+    auto t2 = findTable(original, "ingress.t2");
+    ASSERT_TRUE(t2 != nullptr);
+    p4configv1::P4Info previous(*original.p4Info);
+    for (auto& table : *previous.mutable_tables()) {
+        if (table.preamble().name() == "ingress.t1") {
+            table.set_size(table.size() + 1);
+        } else if (table.preamble().name() == "ingress.t2") {
+            table.mutable_preamble()->set_name("ingress.removed");
+        }
+    }
+    {
+        std::string text;
+        ASSERT_TRUE(google::protobuf::TextFormat::PrintToString(previous, &text));
+        std::ofstream out("p4info_diff_previous.txt");
+        out << text;
+    }
+
+    CompilerOptions options;
+    options.p4RuntimePreviousP4Info = "p4info_diff_previous.txt";
+    options.p4RuntimeP4InfoDiffFile = "p4info_diff.txt";
+    P4::P4RuntimeSerializer::get()->serializeP4RuntimeIfRequired(
+        frontendTestCase->program, options);
+    EXPECT_EQ(0u, ::diagnosticCount());
+
+    auto updated = P4::P4RuntimeSerializer::get()->generateP4Runtime(
+        frontendTestCase->program, defaultArch, nullptr, &previous);
+    auto t1Updated = findTable(updated, "ingress.t1");
+    auto t2Updated = findTable(updated, "ingress.t2");
+    ASSERT_TRUE(t1Updated != nullptr);
+    ASSERT_TRUE(t2Updated != nullptr);
+
+    std::ifstream in("p4info_diff.txt");
+    std::stringstream diff;
+    diff << in.rdbuf();
+    // Objects are listed by P4Info field and name; the action is unchanged.
+    EXPECT_EQ("- tables ingress.removed " + std::to_string(t2->preamble().id()) + "\n" +
+              "~ tables ingress.t1 " + std::to_string(t1Updated->preamble().id()) + "\n" +
+              "+ tables ingress.t2 " + std::to_string(t2Updated->preamble().id()) + "\n",
+              diff.str());
+}
+
 TEST_F(P4Runtime, IsConstTable) {
     auto test = createP4RuntimeTestCase(P4_SOURCE(P4Headers::V1MODEL, R"(
         header Header { bit<8> hfA; }
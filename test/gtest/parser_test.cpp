@@ -0,0 +1,99 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+
+#include "frontends/common/parseInput.h"
+
+namespace Test {
+
+namespace {
+
+/// A program with many headers and a long control, similar to the
+/// programs produced by generators.  Each header is declared on a single
+/// line, so lines contain many tokens.
+std::string largeProgram(unsigned headers, unsigned fields) {
+    std::stringstream src;
+    for (unsigned h = 0; h < headers; h++) {
+        src << "header h" << h << "_t {";
+        for (unsigned f = 0; f < fields; f++)
+            src << " bit<8> f" << f << ";";
+        src << " }\n";
+    }
+    src << "struct headers_t {";
+    for (unsigned h = 0; h < headers; h++)
+        src << " h" << h << "_t h" << h << ";";
+    src << " }\n";
+    src << "control c(inout headers_t hdr) {\n"
+        << "    apply {\n";
+    for (unsigned h = 0; h < headers; h++)
+        src << "        hdr.h" << h << ".f0 = hdr.h" << h << ".f1 + 8w1;\n";
+    src << "    }\n}\n";
+    return src.str();
+}
+
+}  // namespace
+
+class P4CParser : public P4CTest { };
+
+TEST_F(P4CParser, LargeProgram) {
+    const unsigned headers = 2000;
+    std::string program = P4_SOURCE(largeProgram(headers, 16).c_str());
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    unsigned count = 0;
+    for (auto obj : pgm->objects)
+        if (obj->is<IR::Type_Header>())
+            count++;
+    EXPECT_EQ(headers, count);
+}
+
+// Keywords and operators reuse the text of their token kind; each
+// occurrence still has its own source position.
+TEST_F(P4CParser, FixedTokens) {
+    std::string program =
+        "@tokens(action + action ==\n"
+        "        action == + action) header H { }\n";
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    ASSERT_EQ(1U, pgm->objects.size());
+    auto header = pgm->objects.at(0)->to<IR::Type_Header>();
+    ASSERT_TRUE(header != nullptr);
+    auto annotation = header->getAnnotation("tokens");
+    ASSERT_TRUE(annotation != nullptr);
+
+    std::vector<std::string> tokens;
+    for (auto token : annotation->body) {
+        auto start = token->srcInfo.getStart();
+        std::stringstream desc;
+        desc << token->text << " " << start.getLineNumber() << ":" << start.getColumnNumber();
+        tokens.push_back(desc.str());
+    }
+    std::vector<std::string> expected = {
+        "action 1:8", "+ 1:15", "action 1:17", "== 1:24",
+        "action 2:8", "== 2:15", "+ 2:18", "action 2:20"
+    };
+    EXPECT_EQ(expected, tokens);
+}
+
+}  // namespace Test
@@ -76,6 +76,21 @@ TEST(UtilSourceFile, InputSources) {
     EXPECT_EQ(5u, original.sourceLine);
 }
 
+TEST(UtilSourceFile, InputSourcesLastLine) {
+    Util::InputSources sources;
+    sources.appendText("a b");
+    sources.appendText(" c");
+    EXPECT_EQ(1u, sources.lineCount());
+    EXPECT_EQ("a b c", sources.getLine(1));
+    EXPECT_EQ(5u, sources.getCurrentPosition().getColumnNumber());
+
+    sources.appendText("\n");
+    EXPECT_EQ(1u, sources.lineCount());
+    EXPECT_EQ("a b c\n", sources.getLine(1));
+    EXPECT_EQ(2u, sources.getCurrentPosition().getLineNumber());
+    EXPECT_EQ(0u, sources.getCurrentPosition().getColumnNumber());
+}
+
 TEST(UtilSourceFile, SourceInfo) {
     Util::InputSources sources;
 
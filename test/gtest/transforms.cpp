@@ -14,9 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <sstream>
+
 #include "gtest/gtest.h"
 #include "helpers.h"
 #include "ir/ir.h"
+#include "ir/mem_accounting.h"
 #include "ir/visitor.h"
 #include "lib/source_file.h"
 
@@ -43,4 +46,142 @@ TEST_F(P4C_IR, Transform) {
     EXPECT_EQ(e, n);
 }
 
+namespace {
+
+/// Removes odd constants, and replaces multiples of 4 by two copies.
+struct SpliceConstants : public Transform {
+    const IR::Node* postorder(IR::Constant* c) override {
+        auto value = c->asInt();
+        if (value % 2 != 0)
+            return nullptr;
+        if (value % 4 == 0) {
+            auto result = new IR::Vector<IR::Expression>();
+            result->push_back(c);
+            result->push_back(new IR::Constant(value));
+            return result; }
+        return c;
+    }
+};
+
+IR::Vector<IR::Expression>* constants(int count) {
+    auto result = new IR::Vector<IR::Expression>();
+    for (int i = 0; i < count; i++)
+        result->push_back(new IR::Constant(i));
+    return result;
+}
+
+}  // namespace
+
+TEST_F(P4C_IR, VectorSplice) {
+    auto vec = constants(10)->apply(SpliceConstants())->to<IR::Vector<IR::Expression>>();
+    ASSERT_TRUE(vec != nullptr);
+    std::vector<int> expected = { 0, 0, 2, 4, 4, 6, 8, 8 };
+    ASSERT_EQ(expected.size(), vec->size());
+    for (size_t i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected[i], vec->at(i)->to<IR::Constant>()->asInt());
+}
+
+TEST_F(P4C_IR, IndexedVectorSplice) {
+    struct RemoveOdd : public Transform {
+        const IR::Node* postorder(IR::Declaration_Variable* d) override {
+            if (d->name.name == "v1" || d->name.name == "v3")
+                return nullptr;
+            if (d->name.name == "v2") {
+                auto result = new IR::Vector<IR::Declaration>();
+                result->push_back(d);
+                result->push_back(new IR::Declaration_Variable(
+                    IR::ID("v5"), IR::Type_Bits::get(8), nullptr));
+                return result; }
+            return d;
+        }
+    };
+
+    auto decls = new IR::IndexedVector<IR::Declaration>();
+    for (int i = 0; i < 5; i++)
+        decls->push_back(new IR::Declaration_Variable(
+            IR::ID(cstring("v") + Util::toString(i)), IR::Type_Bits::get(8), nullptr));
+    auto result = decls->apply(RemoveOdd())->to<IR::IndexedVector<IR::Declaration>>();
+    ASSERT_TRUE(result != nullptr);
+    ASSERT_EQ(4u, result->size());
+    EXPECT_EQ("v0", result->at(0)->getName().name);
+    EXPECT_EQ("v2", result->at(1)->getName().name);
+    EXPECT_EQ("v5", result->at(2)->getName().name);
+    EXPECT_EQ("v4", result->at(3)->getName().name);
+    EXPECT_TRUE(result->getDeclaration("v1") == nullptr);
+    EXPECT_TRUE(result->getDeclaration("v3") == nullptr);
+    EXPECT_TRUE(result->getDeclaration("v5") != nullptr);
+}
+
+TEST_F(P4C_IR, DeleteUnchangedClones) {
+    struct Negate : public Transform {
+        Negate() { deleteUnchangedClones = true; }
+        const IR::Node* postorder(IR::Constant* c) override {
+            if (c->asInt() == 1)
+                return new IR::Constant(-1);
+            return c;
+        }
+    };
+
+    auto vec = constants(4);
+    auto result = vec->apply(Negate())->to<IR::Vector<IR::Expression>>();
+    ASSERT_TRUE(result != nullptr);
+    EXPECT_NE(vec, result);
+    ASSERT_EQ(4u, result->size());
+    EXPECT_EQ(vec->at(0), result->at(0));
+    EXPECT_EQ(-1, result->at(1)->to<IR::Constant>()->asInt());
+    EXPECT_EQ(vec->at(2), result->at(2));
+
+    auto unchanged = constants(4);
+    unchanged->at(1) = new IR::Constant(5);
+    EXPECT_EQ(unchanged, unchanged->apply(Negate()));
+}
+
+TEST_F(P4C_IR, ChildFields) {
+    struct ChildNames : public Inspector {
+        std::vector<std::string> names;
+        bool preorder(const IR::Constant*) override {
+            names.push_back(getContext()->child_name);
+            return true;
+        }
+    };
+
+    auto one = new IR::Constant(1);
+    auto e = new IR::Mul(new IR::Add(one, new IR::Constant(2)), new IR::Constant(3));
+    EXPECT_EQ(IR::ChildFields::Fields, e->child_fields().kind);
+    EXPECT_EQ(IR::ChildFields::Elements, constants(1)->child_fields().kind);
+
+    ChildNames names;
+    e->apply(names);
+    std::vector<std::string> expected = { "left", "right", "right" };
+    EXPECT_EQ(expected, names.names);
+}
+
+// Removing or expanding many elements of a vector must take linear time;
+// the size keeps a quadratic splice visible in the test run time.
+TEST_F(P4C_IR, VectorSpliceLarge) {
+    const int count = 100000;
+    auto vec = constants(count);
+    auto result = vec->apply(SpliceConstants())->to<IR::Vector<IR::Expression>>();
+    ASSERT_TRUE(result != nullptr);
+    EXPECT_EQ(static_cast<size_t>(count / 4 * 3), result->size());
+}
+
+TEST_F(P4C_IR, MemoryAccounting) {
+    struct Increment : public Transform {
+        Increment() { setName("IncrementConstants"); }
+        const IR::Node* postorder(IR::Constant* c) override
+        { return new IR::Constant(c->value + 1); }
+    };
+
+    IR::MemoryAccounting::enable();
+    auto result = constants(100)->apply(Increment());
+    IR::MemoryAccounting::disable();
+    ASSERT_TRUE(result != nullptr);
+
+    std::stringstream report;
+    IR::MemoryAccounting::report(report);
+    EXPECT_NE(std::string::npos, report.str().find("\nConstant "));
+    EXPECT_NE(std::string::npos, report.str().find("\nIncrementConstants "));
+}
+
 }  // namespace Test
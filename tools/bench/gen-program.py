@@ -0,0 +1,368 @@
+#!/usr/bin/env python
+# Copyright 2013-present Barefoot Networks, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+""" Generates synthetic P4-16 programs of a given size for the v1model or
+    psa architecture, used to measure how the compiler scales with the
+    size of its input.
+
+    The program declares 'headers' header types of 'fields' fields each,
+    and optionally a header stack of 'stack-size' elements.  The parser
+    is a chain of 'parser-depth' states extracting the headers in turn,
+    followed by a loop extracting the stack.  The ingress applies
+    'nesting' controls, each instantiating the next one; the innermost
+    applies 'tables' tables, each with 'keys' keys and 'actions'
+    actions."""
+
+from __future__ import print_function
+import argparse
+import sys
+
+WIDTHS = [8, 16, 32]
+
+
+class Architecture(object):
+    """ The architecture-specific parts of the program. """
+    def __init__(self, gen):
+        self.gen = gen
+
+
+class V1Model(Architecture):
+    include = "v1model.p4"
+    # parameter holding the output port, passed to the nested controls
+    std_param = "inout standard_metadata_t standard_metadata"
+    std_arg = "standard_metadata"
+    port_type = "bit<9>"
+
+    def send(self, port):
+        return "standard_metadata.egress_spec = %s;" % port
+
+    def package(self):
+        g = self.gen
+        g.emit(0, "parser ParserImpl(packet_in packet, out headers_t hdr, "
+               "inout metadata_t meta,")
+        g.emit(0, "                  inout standard_metadata_t standard_metadata) {")
+        g.emit(1, "CommonParser() p;")
+        g.emit(1, "state start {")
+        g.emit(2, "p.apply(packet, hdr, meta);")
+        g.emit(2, "transition accept;")
+        g.emit(1, "}")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.ingress("ingress", "inout standard_metadata_t standard_metadata")
+        g.emit(0, "control egress(inout headers_t hdr, inout metadata_t meta,")
+        g.emit(0, "               inout standard_metadata_t standard_metadata) {")
+        g.emit(1, "apply { }")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.emit(0, "control DeparserImpl(packet_out packet, in headers_t hdr) {")
+        g.emit(1, "CommonDeparser() d;")
+        g.emit(1, "apply { d.apply(packet, hdr); }")
+        g.emit(0, "}")
+        g.emit(0, "")
+        for name in ["verifyChecksum", "computeChecksum"]:
+            g.emit(0, "control %s(inout headers_t hdr, inout metadata_t meta) {" % name)
+            g.emit(1, "apply { }")
+            g.emit(0, "}")
+            g.emit(0, "")
+        g.emit(0, "V1Switch(ParserImpl(), verifyChecksum(), ingress(), egress(), "
+               "computeChecksum(), DeparserImpl()) main;")
+
+
+class PSA(Architecture):
+    include = "psa.p4"
+    std_param = "inout psa_ingress_output_metadata_t ostd"
+    std_arg = "ostd"
+    port_type = "PortId_t"
+
+    def send(self, port):
+        return "send_to_port(ostd, %s);" % port
+
+    def package(self):
+        g = self.gen
+        g.emit(0, "struct empty_metadata_t { }")
+        g.emit(0, "")
+        g.emit(0, "parser IngressParserImpl(packet_in packet, out headers_t hdr, "
+               "inout metadata_t meta,")
+        g.emit(0, "                         in psa_ingress_parser_input_metadata_t istd,")
+        g.emit(0, "                         in empty_metadata_t resubmit_meta,")
+        g.emit(0, "                         in empty_metadata_t recirculate_meta) {")
+        g.emit(1, "CommonParser() p;")
+        g.emit(1, "state start {")
+        g.emit(2, "p.apply(packet, hdr, meta);")
+        g.emit(2, "transition accept;")
+        g.emit(1, "}")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.ingress("ingress", "in psa_ingress_input_metadata_t istd, "
+                  "inout psa_ingress_output_metadata_t ostd")
+        g.emit(0, "control IngressDeparserImpl(packet_out packet, "
+               "out empty_metadata_t clone_i2e_meta,")
+        g.emit(0, "                            out empty_metadata_t resubmit_meta, "
+               "out empty_metadata_t normal_meta,")
+        g.emit(0, "                            inout headers_t hdr, in metadata_t meta,")
+        g.emit(0, "                            in psa_ingress_output_metadata_t istd) {")
+        g.emit(1, "CommonDeparser() d;")
+        g.emit(1, "apply { d.apply(packet, hdr); }")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.emit(0, "parser EgressParserImpl(packet_in packet, out headers_t hdr, "
+               "inout metadata_t meta,")
+        g.emit(0, "                        in psa_egress_parser_input_metadata_t istd,")
+        g.emit(0, "                        in empty_metadata_t normal_meta,")
+        g.emit(0, "                        in empty_metadata_t clone_i2e_meta,")
+        g.emit(0, "                        in empty_metadata_t clone_e2e_meta) {")
+        g.emit(1, "CommonParser() p;")
+        g.emit(1, "state start {")
+        g.emit(2, "p.apply(packet, hdr, meta);")
+        g.emit(2, "transition accept;")
+        g.emit(1, "}")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.emit(0, "control egress(inout headers_t hdr, inout metadata_t meta,")
+        g.emit(0, "               in psa_egress_input_metadata_t istd,")
+        g.emit(0, "               inout psa_egress_output_metadata_t ostd) {")
+        g.emit(1, "apply { }")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.emit(0, "control EgressDeparserImpl(packet_out packet, "
+               "out empty_metadata_t clone_e2e_meta,")
+        g.emit(0, "                           out empty_metadata_t recirculate_meta,")
+        g.emit(0, "                           inout headers_t hdr, in metadata_t meta,")
+        g.emit(0, "                           in psa_egress_output_metadata_t istd,")
+        g.emit(0, "                           in psa_egress_deparser_input_metadata_t edstd) {")
+        g.emit(1, "CommonDeparser() d;")
+        g.emit(1, "apply { d.apply(packet, hdr); }")
+        g.emit(0, "}")
+        g.emit(0, "")
+        g.emit(0, "IngressPipeline(IngressParserImpl(), ingress(), IngressDeparserImpl()) ip;")
+        g.emit(0, "EgressPipeline(EgressParserImpl(), egress(), EgressDeparserImpl()) ep;")
+        g.emit(0, "PSA_Switch(ip, PacketReplicationEngine(), ep, BufferingQueueingEngine()) main;")
+
+
+ARCHITECTURES = {"v1model": V1Model, "psa": PSA}
+
+
+class Generator(object):
+    def __init__(self, args):
+        self.headers = max(args.headers, 1)
+        self.fields = max(args.fields, 1)
+        self.stack_size = max(args.stack_size, 0)
+        self.parser_depth = max(args.parser_depth, 1)
+        self.tables = max(args.tables, 0)
+        self.keys = max(args.keys, 1)
+        self.actions = max(args.actions, 1)
+        self.nesting = max(args.nesting, 0)
+        self.arch = ARCHITECTURES[args.arch](self)
+        self.lines = []
+
+    def emit(self, indent, text):
+        self.lines.append("    " * indent + text)
+
+    def width(self, field):
+        return WIDTHS[field % len(WIDTHS)]
+
+    def header_types(self):
+        for h in range(self.headers):
+            self.emit(0, "header h%d_t {" % h)
+            self.emit(1, "bit<8> next;")
+            for f in range(self.fields):
+                self.emit(1, "bit<%d> f%d;" % (self.width(f), f))
+            self.emit(0, "}")
+            self.emit(0, "")
+        if self.stack_size:
+            self.emit(0, "header stack_elem_t {")
+            self.emit(1, "bit<8> more;")
+            self.emit(1, "bit<16> v;")
+            self.emit(0, "}")
+            self.emit(0, "")
+        self.emit(0, "struct headers_t {")
+        for h in range(self.headers):
+            self.emit(1, "h%d_t h%d;" % (h, h))
+        if self.stack_size:
+            self.emit(1, "stack_elem_t[%d] stack;" % self.stack_size)
+        self.emit(0, "}")
+        self.emit(0, "")
+        self.emit(0, "struct metadata_t {")
+        self.emit(1, "bit<32> m;")
+        self.emit(0, "}")
+        self.emit(0, "")
+
+    def parser(self):
+        """ A chain of 'parser_depth' states; state i extracts header
+            i % headers and either continues to the next state or stops.
+            The last state continues to the header stack. """
+        last = "parse_stack" if self.stack_size else "accept"
+        self.emit(0, "parser CommonParser(packet_in packet, out headers_t hdr, "
+                  "inout metadata_t meta) {")
+        for s in range(self.parser_depth):
+            name = "start" if s == 0 else "s%d" % s
+            h = s % self.headers
+            self.emit(1, "state %s {" % name)
+            self.emit(2, "packet.extract(hdr.h%d);" % h)
+            following = "s%d" % (s + 1) if s + 1 < self.parser_depth else last
+            self.emit(2, "transition select(hdr.h%d.next) {" % h)
+            self.emit(3, "8w%d: %s;" % ((s + 1) % 256, following))
+            self.emit(3, "default: accept;")
+            self.emit(2, "}")
+            self.emit(1, "}")
+        if self.stack_size:
+            self.emit(1, "state parse_stack {")
+            self.emit(2, "packet.extract(hdr.stack.next);")
+            self.emit(2, "transition select(hdr.stack.last.more) {")
+            self.emit(3, "8w0: accept;")
+            self.emit(3, "default: parse_stack;")
+            self.emit(2, "}")
+            self.emit(1, "}")
+        self.emit(0, "}")
+        self.emit(0, "")
+
+    def deparser(self):
+        self.emit(0, "control CommonDeparser(packet_out packet, in headers_t hdr) {")
+        self.emit(1, "apply {")
+        for h in range(self.headers):
+            self.emit(2, "packet.emit(hdr.h%d);" % h)
+        if self.stack_size:
+            self.emit(2, "packet.emit(hdr.stack);")
+        self.emit(1, "}")
+        self.emit(0, "}")
+        self.emit(0, "")
+
+    def key_field(self, t, k):
+        """ Key k of table t; the keys of a table are distinct fields. """
+        index = t * self.fields + k
+        return "hdr.h%d.f%d" % (index // self.fields % self.headers, index % self.fields)
+
+    def tables_control(self):
+        """ The innermost control, which applies the tables. """
+        arch = self.arch
+        self.emit(0, "control c0(inout headers_t hdr, inout metadata_t meta, %s) {" %
+                  arch.std_param)
+        for t in range(self.tables):
+            h = t % self.headers
+            for a in range(self.actions):
+                f = (t + a) % self.fields
+                self.emit(1, "action t%d_a%d(bit<%d> v, %s port) {" %
+                          (t, a, self.width(f), arch.port_type))
+                self.emit(2, "hdr.h%d.f%d = v;" % (h, f))
+                self.emit(2, "meta.m = meta.m + %d;" % (a + 1))
+                self.emit(2, arch.send("port"))
+                self.emit(1, "}")
+            self.emit(1, "table t%d {" % t)
+            self.emit(2, "key = {")
+            for k in range(self.keys):
+                kind = "exact" if k % 2 == 0 else "ternary"
+                self.emit(3, "%s: %s;" % (self.key_field(t, k), kind))
+            self.emit(2, "}")
+            self.emit(2, "actions = {")
+            for a in range(self.actions):
+                self.emit(3, "t%d_a%d;" % (t, a))
+            self.emit(3, "NoAction;")
+            self.emit(2, "}")
+            self.emit(2, "default_action = NoAction();")
+            self.emit(1, "}")
+        self.emit(1, "apply {")
+        for t in range(self.tables):
+            self.emit(2, "if (hdr.h%d.isValid()) {" % (t % self.headers))
+            self.emit(3, "t%d.apply();" % t)
+            self.emit(2, "}")
+        for i in range(self.stack_size):
+            self.emit(2, "if (hdr.stack[%d].isValid()) {" % i)
+            self.emit(3, "hdr.stack[%d].v = hdr.stack[%d].v + 16w1;" % (i, i))
+            self.emit(2, "}")
+        self.emit(1, "}")
+        self.emit(0, "}")
+        self.emit(0, "")
+
+    def nested_controls(self):
+        """ Control c<n> instantiates and applies control c<n-1>. """
+        arch = self.arch
+        for n in range(1, self.nesting + 1):
+            h = n % self.headers
+            self.emit(0, "control c%d(inout headers_t hdr, inout metadata_t meta, %s) {" %
+                      (n, arch.std_param))
+            self.emit(1, "c%d() inner;" % (n - 1))
+            self.emit(1, "apply {")
+            self.emit(2, "meta.m = meta.m + %d;" % n)
+            self.emit(2, "if (hdr.h%d.isValid()) {" % h)
+            self.emit(3, "inner.apply(hdr, meta, %s);" % arch.std_arg)
+            self.emit(2, "}")
+            self.emit(1, "}")
+            self.emit(0, "}")
+            self.emit(0, "")
+
+    def ingress(self, name, std_params):
+        self.emit(0, "control %s(inout headers_t hdr, inout metadata_t meta," % name)
+        self.emit(0, "        %s) {" % std_params)
+        self.emit(1, "c%d() top;" % self.nesting)
+        self.emit(1, "apply {")
+        self.emit(2, "top.apply(hdr, meta, %s);" % self.arch.std_arg)
+        self.emit(1, "}")
+        self.emit(0, "}")
+        self.emit(0, "")
+
+    def generate(self):
+        self.emit(0, "#include <core.p4>")
+        self.emit(0, "#include <%s>" % self.arch.include)
+        self.emit(0, "")
+        self.header_types()
+        self.parser()
+        self.deparser()
+        self.tables_control()
+        self.nested_controls()
+        self.arch.package()
+        return "\n".join(self.lines) + "\n"
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--arch", choices=sorted(ARCHITECTURES), default="v1model",
+                        help="target architecture")
+    parser.add_argument("--headers", type=int, default=16,
+                        help="number of header types and instances")
+    parser.add_argument("--fields", type=int, default=4,
+                        help="number of fields of each header")
+    parser.add_argument("--stack-size", type=int, default=0,
+                        help="size of the header stack (0 for no stack)")
+    parser.add_argument("--parser-depth", type=int, default=8,
+                        help="number of states extracting headers in the parser")
+    parser.add_argument("--tables", type=int, default=16,
+                        help="number of tables")
+    parser.add_argument("--keys", type=int, default=2,
+                        help="number of keys of each table")
+    parser.add_argument("--actions", type=int, default=2,
+                        help="number of actions of each table, besides NoAction")
+    parser.add_argument("--nesting", type=int, default=0,
+                        help="number of controls nested around the tables")
+    parser.add_argument("-o", "--output", default=None,
+                        help="output file (default: stdout)")
+    args = parser.parse_args(argv[1:])
+    # the keys of a table are distinct fields
+    if args.keys > max(args.headers, 1) * max(args.fields, 1):
+        parser.error("--keys %d is more than the %d fields of %d headers" %
+                     (args.keys, max(args.headers, 1) * max(args.fields, 1),
+                      max(args.headers, 1)))
+
+    program = Generator(args).generate()
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(program)
+    else:
+        sys.stdout.write(program)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+# Copyright 2013-present Barefoot Networks, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+""" Compile-time benchmark for the compiler.
+
+    Compiles the programs listed in a benchmark file with the compilers
+    built in the build directory, records the time spent in each top-level
+    pass (using the pass profiler output enabled by -Tvisitor:1) and the
+    peak memory of the compiler process, and compares them with a stored
+    baseline.  Exits with a non-zero status if any measurement exceeds the
+    baseline by more than the tolerance.
+
+    Each non-comment line of the benchmark file is
+
+        <compiler> <program> [compiler options...]
+
+    where <program> is a path relative to the source directory, or
+    gen:<option>=<value>,... to compile a program produced by
+    gen-program.py with the given options.
+
+    With --scale <option>=<size>,<size>,..., the script instead compiles
+    the programs generated by gen-program.py with the options given by
+    --gen, varying one option over the given sizes, and reports how the
+    time and peak memory grow with the size."""
+
+import argparse
+import json
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+SUCCESS = 0
+FAILURE = 1
+
+# Measurements smaller than these are too noisy to be compared.
+TIME_FLOOR_MS = 20.0
+MEMORY_FLOOR_KB = 4096
+
+# Pass profiler output: <file>:<level>:<indent><pass name> <time> usec
+PROFILE_LINE = re.compile(r"^visitor:1:( *)(\S+) ([-+0-9.e]+) usec\s*$")
+
+
+class Benchmark(object):
+    def __init__(self, compiler, program, args):
+        self.compiler = compiler
+        self.program = program
+        self.args = args
+        self.name = compiler + ":" + self.program_name()
+
+    def program_name(self):
+        if self.program.startswith("gen:"):
+            return self.program
+        name = os.path.basename(self.program)
+        for a in self.args:
+            name += " " + a
+        return name
+
+
+def read_benchmarks(filename):
+    result = []
+    with open(filename) as f:
+        for line in f:
+            line = line.split("#", 1)[0].split()
+            if len(line) < 2:
+                continue
+            result.append(Benchmark(line[0], line[1], line[2:]))
+    return result
+
+
+def generate_program(spec, tmpdir):
+    """ Runs gen-program.py for a gen:<option>=<value>,... program. """
+    output = os.path.join(tmpdir, "synthetic.p4")
+    generator = os.path.join(os.path.dirname(os.path.abspath(__file__)), "gen-program.py")
+    args = [sys.executable, generator, "-o", output]
+    for option in spec[len("gen:"):].split(","):
+        key, _, value = option.partition("=")
+        args += ["--" + key, value]
+    subprocess.check_call(args)
+    return output
+
+
+def run_once(options, bench, tmpdir):
+    """ Compiles one program; returns its measurements, or None on failure. """
+    if bench.program.startswith("gen:"):
+        program = generate_program(bench.program, tmpdir)
+    else:
+        program = os.path.join(options.source_dir, bench.program)
+    binary = os.path.join(options.build_dir, bench.compiler)
+    args = [binary, "-Tvisitor:1"] + bench.args
+    if bench.compiler.startswith("p4c-bm2"):
+        args += ["-o", os.path.join(tmpdir, "out.json")]
+    args.append(program)
+    if options.verbose:
+        print(" ".join(args))
+
+    log = os.path.join(tmpdir, "profile.log")
+    with open(log, "w") as stderr, open(os.devnull, "w") as stdout:
+        start = time.time()
+        proc = subprocess.Popen(args, stdout=stdout, stderr=stderr)
+        _, status, usage = os.wait4(proc.pid, 0)
+        elapsed = (time.time() - start) * 1000.0
+        proc.returncode = status
+    if status != 0:
+        print("*** " + bench.name + " failed; log in " + log, file=sys.stderr)
+        return None
+
+    phases = {}
+    with open(log) as f:
+        for line in f:
+            m = PROFILE_LINE.match(line)
+            if m is None or m.group(1):
+                continue
+            phases[m.group(2)] = phases.get(m.group(2), 0.0) + float(m.group(3)) / 1000.0
+    # parsing, reading the includes and writing the output
+    phases["other"] = max(elapsed - sum(phases.values()), 0.0)
+    # ru_maxrss is in kilobytes on Linux
+    return {"time": elapsed, "memory": usage.ru_maxrss, "phases": phases}
+
+
+def run(options, bench):
+    """ Compiles a program 'repeat' times, keeping the fastest time of
+        each phase, which is the least affected by other processes. """
+    tmpdir = tempfile.mkdtemp(dir=".", prefix="bench-")
+    result = None
+    try:
+        for _ in range(options.repeat):
+            r = run_once(options, bench, tmpdir)
+            if r is None:
+                return None
+            if result is None:
+                result = r
+                continue
+            result["time"] = min(result["time"], r["time"])
+            result["memory"] = min(result["memory"], r["memory"])
+            for p, t in r["phases"].items():
+                result["phases"][p] = min(result["phases"].get(p, t), t)
+    finally:
+        if options.cleanup:
+            shutil.rmtree(tmpdir)
+    return result
+
+
+def regressed(base, value, tolerance, floor):
+    return value > base * (1.0 + tolerance / 100.0) and value - base > floor
+
+
+def compare(options, results, baseline):
+    """ Prints the measurements next to the baseline; returns the number
+        of regressions. """
+    regressions = 0
+    fmt = "{0:<48} {1:>12} {2:>12} {3:>8}"
+    print(fmt.format("benchmark", "baseline", "current", "change"))
+    for name in sorted(results):
+        r = results[name]
+        b = baseline.get(name)
+        rows = [("time (ms)", r["time"], b and b["time"], options.tolerance, TIME_FLOOR_MS),
+                ("memory (KB)", r["memory"], b and b["memory"],
+                 options.memory_tolerance, MEMORY_FLOOR_KB)]
+        for phase in sorted(r["phases"]):
+            rows.append(("  " + phase + " (ms)", r["phases"][phase],
+                         b and b["phases"].get(phase), options.tolerance, TIME_FLOOR_MS))
+        print(name)
+        for label, value, base, tolerance, floor in rows:
+            if base is None:
+                print(fmt.format("  " + label, "-", "%.1f" % value, ""))
+                continue
+            change = "%+.1f%%" % ((value - base) * 100.0 / base) if base else ""
+            flag = ""
+            if regressed(base, value, tolerance, floor):
+                flag = "  *** regression"
+                regressions += 1
+            print(fmt.format("  " + label, "%.1f" % base, "%.1f" % value, change) + flag)
+    return regressions
+
+
+def growth(size0, value0, size1, value1):
+    """ The exponent k such that value grows as size^k between two sizes. """
+    if size0 <= 0 or size1 <= size0 or value0 <= 0 or value1 <= 0:
+        return ""
+    return "%.2f" % (math.log(value1 / value0) / math.log(float(size1) / size0))
+
+
+def scale(options):
+    """ Compiles generated programs of increasing size and prints a table
+        of time and peak memory per size; returns the number of failures. """
+    option, _, sizes = options.scale.partition("=")
+    sizes = [int(s) for s in sizes.split(",")]
+    spec = [o for o in options.gen.split(",") if o and not o.startswith(option + "=")]
+    failures = 0
+    fmt = "{0:>8} {1:>12} {2:>8} {3:>12} {4:>8}"
+    for compiler in options.compilers.split(","):
+        print("%s: %s scaling (%s)" % (compiler, option, ",".join(spec)))
+        print(fmt.format(option, "time (ms)", "growth", "memory (KB)", "growth"))
+        previous = None
+        for size in sizes:
+            program = "gen:" + ",".join(spec + ["%s=%d" % (option, size)])
+            r = run(options, Benchmark(compiler, program, []))
+            if r is None:
+                failures += 1
+                continue
+            if previous:
+                ps, pr = previous
+                row = [growth(ps, pr["time"], size, r["time"]),
+                       growth(ps, pr["memory"], size, r["memory"])]
+            else:
+                row = ["", ""]
+            print(fmt.format(size, "%.1f" % r["time"], row[0], r["memory"], row[1]))
+            previous = (size, r)
+    return failures
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("benchmarks", nargs="?", help="file listing the programs to compile")
+    parser.add_argument("--source-dir", default=".", help="compiler source directory")
+    parser.add_argument("--build-dir", default=".", help="directory containing the compilers")
+    parser.add_argument("--baseline", default=None, help="stored baseline (json)")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="replace the baseline with the current measurements")
+    parser.add_argument("--tolerance", type=float, default=10.0,
+                        help="allowed time increase, in percent")
+    parser.add_argument("--memory-tolerance", type=float, default=10.0,
+                        help="allowed peak memory increase, in percent")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="number of compilations of each program")
+    parser.add_argument("--output", default=None, help="write the measurements to a json file")
+    parser.add_argument("--scale", default=None, metavar="OPTION=SIZE,...",
+                        help="measure scaling with a gen-program.py option")
+    parser.add_argument("--gen", default="", metavar="OPTION=VALUE,...",
+                        help="gen-program.py options of the programs used by --scale")
+    parser.add_argument("--compilers", default="p4test",
+                        help="comma-separated compilers used by --scale")
+    parser.add_argument("-b", dest="cleanup", action="store_false",
+                        help="do not remove temporary results")
+    parser.add_argument("-v", dest="verbose", action="store_true", help="verbose operation")
+    options = parser.parse_args(argv[1:])
+    options.repeat = max(options.repeat, 1)
+    if options.scale:
+        return FAILURE if scale(options) else SUCCESS
+    if options.benchmarks is None:
+        parser.error("a benchmark file or --scale is required")
+
+    results = {}
+    failures = 0
+    for bench in read_benchmarks(options.benchmarks):
+        r = run(options, bench)
+        if r is None:
+            failures += 1
+        else:
+            results[bench.name] = r
+
+    if options.output:
+        with open(options.output, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+    if options.update_baseline:
+        if options.baseline is None:
+            print("--update-baseline requires --baseline", file=sys.stderr)
+            return FAILURE
+        with open(options.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print("Baseline written to " + options.baseline)
+
+    baseline = {}
+    if options.baseline and os.path.isfile(options.baseline) and not options.update_baseline:
+        with open(options.baseline) as f:
+            baseline = json.load(f)
+    regressions = compare(options, results, baseline)
+    if regressions:
+        print("%d measurements exceed the baseline by more than the tolerance" % regressions)
+    return FAILURE if failures or regressions else SUCCESS
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
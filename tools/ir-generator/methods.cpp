@@ -32,6 +32,20 @@ enum flags {
     FRIEND = 1024        // friend function, not a method
 };
 
+// How visit_children is defined for a class
+enum class VisitChildren { Generated, Inherited, User };
+static VisitChildren visitChildrenKind(const IrClass *cl) {
+    for (auto el : cl->elements) {
+        if (auto no = el->to<IrNo>()) {
+            if (no->text == "visit_children")
+                return VisitChildren::Inherited;
+        } else if (auto m = el->to<IrMethod>()) {
+            // generated methods have no source position
+            if (m->name == "visit_children" && m->srcInfo.isValid())
+                return VisitChildren::User; } }
+    return VisitChildren::Generated;
+}
+
 const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
 { "operator==", { &NamedType::Bool(), {}, CONST + IN_IMPL + INCL_NESTED + OVERRIDE + CLASSREF,
     [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
@@ -128,6 +142,42 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
             needed = true; }
         buf << "}";
         return needed ? buf.str() : cstring(); } } },
+{ "child_fields", { new ReferenceType(&NamedType::ChildFields(), true), {},
+  CONST + IN_IMPL + OVERRIDE,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        buf << "{" << std::endl;
+        auto kind = visitChildrenKind(cl);
+        if (kind == VisitChildren::User) {
+            buf << cl->indent << "static const IR::ChildFields rv(IR::ChildFields::Custom);"
+                << std::endl;
+        } else {
+            std::stringstream fields;
+            for (auto f : *cl->getFields()) {
+                if (kind == VisitChildren::Inherited)
+                    break;
+                if (f->type->resolve(cl->containedIn) == nullptr)
+                    // This is not an IR pointer
+                    continue;
+                fields << cl->indent << cl->indent << "{ \"" << f->name << "\", "
+                       << "[](const IR::Node *n) -> const IR::Node * { return "
+                       << (f->isInline ? "&" : "") << "static_cast<const " << cl->fullName()
+                       << " *>(n)->" << f->name << "; }, "
+                       << (f->isInline ? "true" : "false") << " }," << std::endl; }
+            std::string parent = "nullptr";
+            if (cl->getParent() != IrClass::nodeClass())
+                parent = "&" + cl->getParent()->name + "::child_fields()";
+            if (fields.str().empty()) {
+                buf << cl->indent << "static const IR::ChildFields rv(" << parent << ");"
+                    << std::endl;
+            } else {
+                buf << cl->indent << "static const IR::ChildField fields[] = {" << std::endl
+                    << fields.str() << cl->indent << "};" << std::endl;
+                buf << cl->indent << "static const IR::ChildFields rv(fields, " << parent
+                    << ");" << std::endl; } }
+        buf << cl->indent << "return rv;" << std::endl;
+        buf << "}";
+        return buf.str(); } } },
 { "validate", { &NamedType::Void(), {}, CONST + IN_IMPL + EXTEND + OVERRIDE,
     [](IrClass *cl, Util::SourceInfo srcInfo, cstring body) -> cstring {
         bool needed = false;
@@ -103,6 +103,11 @@ NamedType& NamedType::JSONObject() {
     return nt;
 }
 
+NamedType& NamedType::ChildFields() {
+    static NamedType nt(new LookupScope("IR"), "ChildFields");
+    return nt;
+}
+
 NamedType& NamedType::SourceInfo() {
     static NamedType nt(new LookupScope("Util"), "SourceInfo");
     return nt;
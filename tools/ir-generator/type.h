@@ -98,6 +98,7 @@ class NamedType : public Type {
     static NamedType& JSONGenerator();
     static NamedType& JSONLoader();
     static NamedType& JSONObject();
+    static NamedType& ChildFields();
     static NamedType& SourceInfo();
 };
 